@@ -0,0 +1,318 @@
+// Benchmarks each FilteredRange operation against the equivalent hand
+// written STL code and prints one CSV row per case to stdout:
+//
+//	operation,value_type,container,size,range_ns,stl_ns,ratio
+//
+// ratio is range_ns / stl_ns, so values above 1 mean the range is slower.
+// Each time is the fastest of several runs.
+//
+// Usage: bench [--min-size=N] [--max-size=N] [--filter=TEXT]
+//	--min-size	smallest number of values, default 1000
+//	--max-size	largest number of values, default 1000000.  Sizes grow by
+//			10x, so --max-size=100000000 runs up to 1e8
+//	--filter	only run operations whose name contains TEXT
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "daw/filtered_range.h"
+
+namespace {
+	struct options {
+		size_t min_size;
+		size_t max_size;
+		std::string filter;
+
+		options( ): min_size( 1000 ), max_size( 1000000 ), filter( ) { }
+	};
+
+	// Keeps the optimizer from dropping the work being timed
+	volatile size_t g_sink = 0;
+
+	template<typename T>
+	struct value_maker;
+
+	template<>
+	struct value_maker<int> {
+		static const char* name( ) {
+			return "int";
+		}
+
+		static int make( uint32_t n ) {
+			return static_cast<int>(n);
+		}
+	};
+
+	template<>
+	struct value_maker<double> {
+		static const char* name( ) {
+			return "double";
+		}
+
+		static double make( uint32_t n ) {
+			return static_cast<double>(n) / 7.0;
+		}
+	};
+
+	template<>
+	struct value_maker<std::string> {
+		static const char* name( ) {
+			return "string";
+		}
+
+		static std::string make( uint32_t n ) {
+			return "key_" + std::to_string( n );
+		}
+	};
+
+	template<typename Container>
+	struct container_name;
+
+	template<typename T>
+	struct container_name<std::vector<T>> {
+		static const char* get( ) {
+			return "vector";
+		}
+	};
+
+	template<typename T>
+	struct container_name<std::list<T>> {
+		static const char* get( ) {
+			return "list";
+		}
+	};
+
+	// Values drawn from [0, size) so that about a third are duplicates
+	template<typename Container>
+	Container make_values( size_t size ) {
+		using value_type = typename Container::value_type;
+		auto rng = std::mt19937( 42 );
+		auto dist = std::uniform_int_distribution<uint32_t>( 0, static_cast<uint32_t>(size - 1) );
+		auto result = Container( );
+		for( size_t n = 0; n < size; ++n ) {
+			result.push_back( value_maker<value_type>::make( dist( rng ) ) );
+		}
+		return result;
+	}
+
+	// Fastest of the runs, repeating small cases so they take long enough
+	// to measure
+	template<typename Func>
+	long long time_ns( size_t size, Func func ) {
+		auto const runs = std::max<size_t>( 3, std::min<size_t>( 50, 1000000 / size ) );
+		auto best = std::chrono::nanoseconds::max( );
+		for( size_t run = 0; run < runs; ++run ) {
+			auto const start = std::chrono::steady_clock::now( );
+			g_sink = g_sink + func( );
+			auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now( ) - start);
+			best = std::min( best, elapsed );
+		}
+		return static_cast<long long>(best.count( ));
+	}
+
+	template<typename Container, typename RangeFunc, typename StlFunc>
+	void run_case( const options& opts, const char* operation, size_t size, RangeFunc range_func, StlFunc stl_func ) {
+		if( std::string( operation ).find( opts.filter ) == std::string::npos ) {
+			return;
+		}
+		auto const range_ns = time_ns( size, range_func );
+		auto const stl_ns = time_ns( size, stl_func );
+		auto const ratio = 0 == stl_ns ? 0.0 : static_cast<double>(range_ns) / static_cast<double>(stl_ns);
+		std::cout << operation << ',' << value_maker<typename Container::value_type>::name( ) << ',' << container_name<Container>::get( ) << ',' << size << ',' << range_ns << ',' << stl_ns << ',' << ratio << std::endl;
+	}
+
+	template<typename Container>
+	void run_suite( const options& opts, size_t size ) {
+		using value_type = typename Container::value_type;
+		using daw::range::create_filtered_range;
+		auto values = make_values<Container>( size );
+		// Two predicates that each keep about half of the values
+		auto const mid = value_maker<value_type>::make( static_cast<uint32_t>(size / 2) );
+		auto const low = value_maker<value_type>::make( static_cast<uint32_t>(size / 4) );
+		auto above_low = [low]( const value_type& value ) { return low < value; };
+		auto below_mid = [mid]( const value_type& value ) { return value < mid; };
+		auto hash_even = []( const value_type& value ) { return 0 == std::hash<value_type>( )( value ) % 2; };
+		auto hash_third = []( const value_type& value ) { return 0 == std::hash<value_type>( )( value ) % 3; };
+
+		run_case<Container>( opts, "to_vector", size, [&]( ) {
+			return create_filtered_range( values ).to_vector( ).size( );
+		}, [&]( ) {
+			return std::vector<value_type>( values.begin( ), values.end( ) ).size( );
+		} );
+
+		run_case<Container>( opts, "where_chain", size, [&]( ) {
+			return create_filtered_range( values ).where( above_low ).where( below_mid ).to_vector( ).size( );
+		}, [&]( ) {
+			auto result = std::vector<value_type>( );
+			std::copy_if( values.begin( ), values.end( ), std::back_inserter( result ), [&]( const value_type& value ) { return above_low( value ) && below_mid( value ); } );
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "sort", size, [&]( ) {
+			return create_filtered_range( values ).where( below_mid ).sort( ).to_vector( ).size( );
+		}, [&]( ) {
+			auto result = std::vector<value_type>( );
+			std::copy_if( values.begin( ), values.end( ), std::back_inserter( result ), below_mid );
+			std::sort( result.begin( ), result.end( ) );
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "stable_unique", size, [&]( ) {
+			return create_filtered_range( values ).stable_unique( ).to_vector( ).size( );
+		}, [&]( ) {
+			auto seen = std::unordered_set<value_type>( );
+			auto result = std::vector<value_type>( );
+			for( auto const & value : values ) {
+				if( seen.insert( value ).second ) {
+					result.push_back( value );
+				}
+			}
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "duplicates", size, [&]( ) {
+			return create_filtered_range( values ).duplicates( ).to_vector( ).size( );
+		}, [&]( ) {
+			auto sorted = std::vector<value_type>( values.begin( ), values.end( ) );
+			std::sort( sorted.begin( ), sorted.end( ) );
+			auto result = std::vector<value_type>( );
+			for( auto it = sorted.begin( ); it != sorted.end( ); ) {
+				auto const next = std::upper_bound( it, sorted.end( ), *it );
+				if( std::distance( it, next ) > 1 ) {
+					result.push_back( *it );
+				}
+				it = next;
+			}
+			return result.size( );
+		} );
+
+		// The set operations over two overlapping subsets of the same values
+		auto stl_subsets = [&]( ) {
+			auto lhs = std::vector<value_type>( );
+			auto rhs = std::vector<value_type>( );
+			std::copy_if( values.begin( ), values.end( ), std::back_inserter( lhs ), hash_even );
+			std::copy_if( values.begin( ), values.end( ), std::back_inserter( rhs ), hash_third );
+			std::sort( lhs.begin( ), lhs.end( ) );
+			std::sort( rhs.begin( ), rhs.end( ) );
+			return std::make_pair( std::move( lhs ), std::move( rhs ) );
+		};
+
+		run_case<Container>( opts, "set_union", size, [&]( ) {
+			auto range = create_filtered_range( values );
+			return range.where( hash_even ).set_union( range.where( hash_third ) ).to_vector( ).size( );
+		}, [&]( ) {
+			auto subsets = stl_subsets( );
+			auto result = std::vector<value_type>( );
+			std::set_union( subsets.first.begin( ), subsets.first.end( ), subsets.second.begin( ), subsets.second.end( ), std::back_inserter( result ) );
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "set_intersection", size, [&]( ) {
+			auto range = create_filtered_range( values );
+			return range.where( hash_even ).set_intersection( range.where( hash_third ) ).to_vector( ).size( );
+		}, [&]( ) {
+			auto subsets = stl_subsets( );
+			auto result = std::vector<value_type>( );
+			std::set_intersection( subsets.first.begin( ), subsets.first.end( ), subsets.second.begin( ), subsets.second.end( ), std::back_inserter( result ) );
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "set_difference", size, [&]( ) {
+			auto range = create_filtered_range( values );
+			return range.where( hash_even ).set_difference( range.where( hash_third ) ).to_vector( ).size( );
+		}, [&]( ) {
+			auto subsets = stl_subsets( );
+			auto result = std::vector<value_type>( );
+			std::set_difference( subsets.first.begin( ), subsets.first.end( ), subsets.second.begin( ), subsets.second.end( ), std::back_inserter( result ) );
+			return result.size( );
+		} );
+
+		run_case<Container>( opts, "set_symmetric_difference", size, [&]( ) {
+			auto range = create_filtered_range( values );
+			return range.where( hash_even ).set_symmetric_difference( range.where( hash_third ) ).to_vector( ).size( );
+		}, [&]( ) {
+			auto subsets = stl_subsets( );
+			auto result = std::vector<value_type>( );
+			std::set_symmetric_difference( subsets.first.begin( ), subsets.first.end( ), subsets.second.begin( ), subsets.second.end( ), std::back_inserter( result ) );
+			return result.size( );
+		} );
+
+		// A few lookups that scan, half of them for missing values
+		static const uint32_t query_count = 16;
+		auto queries = std::vector<value_type>( );
+		for( uint32_t n = 0; n < query_count; ++n ) {
+			queries.push_back( value_maker<value_type>::make( 0 == n % 2 ? static_cast<uint32_t>(size / query_count * n) : static_cast<uint32_t>(size + n) ) );
+		}
+		run_case<Container>( opts, "contains", size, [&]( ) {
+			auto range = create_filtered_range( values );
+			return static_cast<size_t>(std::count_if( queries.begin( ), queries.end( ), [&range]( const value_type& query ) { return range.contains( query ); } ));
+		}, [&]( ) {
+			return static_cast<size_t>(std::count_if( queries.begin( ), queries.end( ), [&values]( const value_type& query ) { return std::find( values.begin( ), values.end( ), query ) != values.end( ); } ));
+		} );
+
+		// Many lookups through an index
+		auto many_queries = std::vector<value_type>( );
+		for( size_t n = 0; n < size; n += 2 ) {
+			many_queries.push_back( value_maker<value_type>::make( static_cast<uint32_t>(n) ) );
+		}
+		run_case<Container>( opts, "contains_all", size, [&]( ) {
+			return static_cast<size_t>(create_filtered_range( values ).contains_all( many_queries ));
+		}, [&]( ) {
+			auto index = std::unordered_set<value_type>( values.begin( ), values.end( ) );
+			return static_cast<size_t>(std::all_of( many_queries.begin( ), many_queries.end( ), [&index]( const value_type& query ) { return index.count( query ) != 0; } ));
+		} );
+	}
+
+	template<typename T>
+	void run_containers( const options& opts, size_t size ) {
+		run_suite<std::vector<T>>( opts, size );
+		run_suite<std::list<T>>( opts, size );
+	}
+
+	bool parse_size( const std::string& arg, const std::string& prefix, size_t& value ) {
+		if( 0 != arg.compare( 0, prefix.size( ), prefix ) ) {
+			return false;
+		}
+		value = static_cast<size_t>(std::strtoull( arg.c_str( ) + prefix.size( ), nullptr, 10 ));
+		return true;
+	}
+}	// namespace
+
+int main( int argc, char** argv ) {
+	auto opts = options( );
+	for( int n = 1; n < argc; ++n ) {
+		auto const arg = std::string( argv[n] );
+		if( parse_size( arg, "--min-size=", opts.min_size ) || parse_size( arg, "--max-size=", opts.max_size ) ) {
+			continue;
+		}
+		if( 0 == arg.compare( 0, 9, "--filter=" ) ) {
+			opts.filter = arg.substr( 9 );
+			continue;
+		}
+		std::cerr << "Usage: " << argv[0] << " [--min-size=N] [--max-size=N] [--filter=TEXT]\n";
+		return EXIT_FAILURE;
+	}
+	if( 0 == opts.min_size || opts.max_size < opts.min_size ) {
+		std::cerr << "--min-size must be at least 1 and no more than --max-size\n";
+		return EXIT_FAILURE;
+	}
+	std::cout << std::fixed << std::setprecision( 3 );
+	std::cout << "operation,value_type,container,size,range_ns,stl_ns,ratio" << std::endl;
+	for( auto size = opts.min_size; size <= opts.max_size; size *= 10 ) {
+		run_containers<int>( opts, size );
+		run_containers<double>( opts, size );
+		run_containers<std::string>( opts, size );
+	}
+	return EXIT_SUCCESS;
+}
@@ -2,4 +2,8 @@
 
 #include "filtered_range_funcs.h"
 #include "filtered_range_class.h"
+#include "filtered_range_selection.h"
+#include "filtered_range_stream.h"
+#include "filtered_range_mmap.h"
+#include "filtered_range_aggregate.h"
 #include "filtered_range_group.h"
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "filtered_range_instrument.h"
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: How often the predicates of an adaptive range are measured.
+			/// A sample_size of 0 evaluates them in the order they were added
+			struct adaptive_options {
+				size_t sample_size;
+				size_t recheck_interval;
+
+				adaptive_options( ): sample_size( 0 ), recheck_interval( 0 ) { }
+
+				adaptive_options( size_t sample, size_t recheck ): sample_size( sample ), recheck_interval( recheck < sample ? sample : recheck ) { }
+
+				bool enabled( ) const {
+					return 0 != sample_size;
+				}
+			};	// struct adaptive_options
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: The order to evaluate a conjunction of predicates in.  A
+			/// sample runs every predicate on every sampled value, timing each one,
+			/// and then orders them by cost / (1 - pass rate), the order with the
+			/// lowest expected cost when the predicates are independent.  Ties and
+			/// predicates that passed the whole sample keep the order they were
+			/// added in.
+			template<typename Predicate>
+			class predicate_plan {
+			public:
+				explicit predicate_plan( const std::vector<Predicate>& predicates ): m_predicates( predicates ), m_order( predicates.size( ) ), m_passed( ) { }
+
+				// Samples values [first, last) of elements and reorders the
+				// predicates.  Afterwards included( n ) says whether the nth sampled
+				// value passed them all
+				template<typename Element, typename Alloc, typename Storage>
+				void sample( const std::vector<Element, Alloc>& elements, size_t first, size_t last, const Storage& storage ) {
+					auto const count = last - first;
+					auto const pred_count = m_predicates.size( );
+					m_passed.assign( count, 1 );
+					auto rank = std::vector<double>( pred_count );
+					for( size_t p = 0; p < pred_count; ++p ) {
+						auto const & pred = m_predicates[p];
+						size_t passes = 0;
+						auto const start = std::chrono::steady_clock::now( );
+						for( size_t n = 0; n < count; ++n ) {
+							DAW_RANGE_PREDICATE_CALL( p );
+							if( pred( storage.deref( elements[first + n] ) ) ) {
+								++passes;
+							} else {
+								m_passed[n] = 0;
+							}
+						}
+						auto const elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+						auto const rejected = static_cast<double>(count - passes) / static_cast<double>(count);
+						rank[p] = passes == count ? std::numeric_limits<double>::infinity( ) : (elapsed / static_cast<double>(count)) / rejected;
+					}
+					for( size_t n = 0; n < m_order.size( ); ++n ) {
+						m_order[n] = n;
+					}
+					std::stable_sort( m_order.begin( ), m_order.end( ), [&rank]( size_t lhs, size_t rhs ) { return rank[lhs] < rank[rhs]; } );
+				}
+
+				bool included( size_t n ) const {
+					return 0 != m_passed[n];
+				}
+
+				template<typename Value>
+				bool operator()( const Value& value ) const {
+					for( auto pos : m_order ) {
+						DAW_RANGE_PREDICATE_CALL( pos );
+						if( !m_predicates[pos]( value ) ) {
+							return false;
+						}
+					}
+					return true;
+				}
+
+			private:
+				const std::vector<Predicate>& m_predicates;
+				std::vector<size_t> m_order;
+				std::vector<char> m_passed;
+			};	// class predicate_plan
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Calls sink( element ) in order on each element whose value
+			/// in storage passes every predicate, reordering the predicates from a
+			/// sample at the start of every recheck_interval elements.  Stops and
+			/// returns false when sink returns false
+			template<typename Predicate, typename Element, typename Alloc, typename Storage, typename Sink>
+			bool adaptive_filter( const std::vector<Predicate>& predicates, const std::vector<Element, Alloc>& elements, const Storage& storage, const adaptive_options& options, Sink sink ) {
+				auto plan = predicate_plan<Predicate>( predicates );
+				for( size_t window = 0; window < elements.size( ); window += options.recheck_interval ) {
+					auto const window_end = std::min( elements.size( ), window + options.recheck_interval );
+					auto const sample_end = std::min( window_end, window + options.sample_size );
+					plan.sample( elements, window, sample_end, storage );
+					for( size_t n = window; n < sample_end; ++n ) {
+						if( plan.included( n - window ) && !sink( elements[n] ) ) {
+							return false;
+						}
+					}
+					for( size_t n = sample_end; n < window_end; ++n ) {
+						if( plan( storage.deref( elements[n] ) ) && !sink( elements[n] ) ) {
+							return false;
+						}
+					}
+				}
+				return true;
+			}
+		}	// namespace impl
+	}	// namespace range
+}	// namespace daw
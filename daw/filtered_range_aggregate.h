@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "filtered_range_class.h"
+#include "filtered_range_hash.h"
+
+namespace daw {
+	namespace range {
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: The values of a FilteredRange grouped by a key, made by
+		/// FilteredRange::group_by.  Each aggregate makes one pass over the
+		/// range, finding the key's slot in an open addressing hash table and
+		/// updating its accumulator in place.  Results are (key, aggregate)
+		/// pairs with the keys in the order they were first seen.
+		template<typename value_type, typename Storage, typename KeyFunc>
+		class GroupedRange {
+		public:
+			using key_type = typename std::decay<decltype(std::declval<KeyFunc&>( )(std::declval<value_type&>( )))>::type;
+
+			GroupedRange( FilteredRange<value_type, Storage> range, KeyFunc key_func, size_t cardinality_hint ): m_range( std::move( range ) ), m_key_func( std::move( key_func ) ), m_cardinality_hint( cardinality_hint ) { }
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of values with each key
+			std::vector<std::pair<key_type, size_t>> count( ) const {
+				return aggregate( []( const value_type& ) { return size_t( 1 ); }, []( size_t& total, const value_type& ) { ++total; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sum of value_func( value ) over the values with each key
+			template<typename ValueFunc>
+			auto sum( ValueFunc value_func ) const -> std::vector<std::pair<key_type, typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type>> {
+				using result_t = typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type;
+				return aggregate( [&value_func]( const value_type& value ) { return static_cast<result_t>(value_func( value )); }, [&value_func]( result_t& total, const value_type& value ) { total += value_func( value ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sum of the values with each key
+			std::vector<std::pair<key_type, value_type>> sum( ) const {
+				return sum( []( const value_type& value ) { return value; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Smallest value_func( value ) by comp for each key
+			template<typename ValueFunc, typename LessThanCompare = std::less<typename std::decay<decltype(std::declval<ValueFunc&>( )(std::declval<value_type&>( )))>::type>>
+			auto min( ValueFunc value_func, LessThanCompare comp = LessThanCompare( ) ) const -> std::vector<std::pair<key_type, typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type>> {
+				using result_t = typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type;
+				return aggregate( [&value_func]( const value_type& value ) { return value_func( value ); }, [&value_func, &comp]( result_t& smallest, const value_type& value ) {
+					auto current = value_func( value );
+					if( comp( current, smallest ) ) {
+						smallest = std::move( current );
+					}
+				} );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Smallest value for each key
+			std::vector<std::pair<key_type, value_type>> min( ) const {
+				return min( []( const value_type& value ) { return value; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Largest value_func( value ) by comp for each key
+			template<typename ValueFunc, typename LessThanCompare = std::less<typename std::decay<decltype(std::declval<ValueFunc&>( )(std::declval<value_type&>( )))>::type>>
+			auto max( ValueFunc value_func, LessThanCompare comp = LessThanCompare( ) ) const -> std::vector<std::pair<key_type, typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type>> {
+				using result_t = typename std::decay<decltype(value_func( std::declval<value_type&>( ) ))>::type;
+				return aggregate( [&value_func]( const value_type& value ) { return value_func( value ); }, [&value_func, &comp]( result_t& largest, const value_type& value ) {
+					auto current = value_func( value );
+					if( comp( largest, current ) ) {
+						largest = std::move( current );
+					}
+				} );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Largest value for each key
+			std::vector<std::pair<key_type, value_type>> max( ) const {
+				return max( []( const value_type& value ) { return value; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Folds the values with each key, starting each key from init.
+			/// fold( accumulator, value ) returns the new accumulator
+			template<typename Accumulator, typename Fold>
+			std::vector<std::pair<key_type, Accumulator>> fold( Accumulator init, Fold fold_func ) const {
+				return aggregate( [&init, &fold_func]( const value_type& value ) { return static_cast<Accumulator>(fold_func( init, value )); }, [&fold_func]( Accumulator& total, const value_type& value ) { total = fold_func( std::move( total ), value ); } );
+			}
+
+		private:
+			FilteredRange<value_type, Storage> m_range;
+			KeyFunc m_key_func;
+			size_t m_cardinality_hint;
+
+			// first( value ) makes the accumulator for a new key, next( acc, value )
+			// updates an existing one
+			template<typename First, typename Next>
+			auto aggregate( First first, Next next ) const -> std::vector<std::pair<key_type, typename std::decay<decltype(first( std::declval<value_type&>( ) ))>::type>> {
+				using accumulator_t = typename std::decay<decltype(first( std::declval<value_type&>( ) ))>::type;
+				auto table = impl::open_hash_table<key_type, std::hash<key_type>, std::equal_to<key_type>>( m_cardinality_hint, std::hash<key_type>( ), std::equal_to<key_type>( ) );
+				auto totals = std::vector<accumulator_t>( );
+				totals.reserve( m_cardinality_hint );
+				auto& key_func = m_key_func;
+				m_range.each_included( [&]( value_type& value ) {
+					auto const pos = table.find_or_insert( key_func( value ) );
+					if( pos.second ) {
+						totals.push_back( first( value ) );
+					} else {
+						next( totals[pos.first], value );
+					}
+					return true;
+				} );
+				auto keys = table.release_keys( );
+				auto result = std::vector<std::pair<key_type, accumulator_t>>( );
+				result.reserve( keys.size( ) );
+				for( size_t n = 0; n < keys.size( ); ++n ) {
+					result.emplace_back( std::move( keys[n] ), std::move( totals[n] ) );
+				}
+				return result;
+			}
+		};	// class GroupedRange
+	}	// namespace range
+}	// namespace daw
@@ -1,44 +1,481 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <boost/iterator/filter_iterator.hpp>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <set>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#include "filtered_range_adaptive.h"
+#include "filtered_range_hash.h"
+#include "filtered_range_instrument.h"
+#include "filtered_range_memory.h"
+#include "filtered_range_parallel.h"
+#include "filtered_range_radix.h"
+
 namespace daw {
 	namespace range {
+		template<typename value_type, typename Stage>
+		class LazyFilteredRange;
+
 		template<typename value_type>
+		class SelectedRange;
+
+		template<typename value_type, typename Storage>
+		class FilteredRangeGroup;
+
+		template<typename value_type, typename Storage, typename KeyFunc>
+		class GroupedRange;
+
+		namespace impl {
+			template<typename value_type, typename Storage>
+			struct lazy_source;
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: A vector whose copies share storage until one of them is
+			/// modified through mut( ).  Copying is O(1).  The vector and its
+			/// control block come from Allocator
+			template<typename T, typename Allocator = std::allocator<T>>
+			class shared_vector {
+			public:
+				using vector_type = std::vector<T, Allocator>;
+				using allocator_type = Allocator;
+
+				shared_vector( ): m_values( ), m_alloc( ) { }
+
+				explicit shared_vector( const Allocator& alloc ): m_values( ), m_alloc( alloc ) { }
+
+				template<typename Iter>
+				shared_vector( Iter first_inclusive, Iter last_exclusive, const Allocator& alloc = Allocator( ) ): m_values( std::allocate_shared<vector_type>( alloc, first_inclusive, last_exclusive, alloc ) ), m_alloc( alloc ) {
+					DAW_RANGE_ALLOCATION( m_values->capacity( ) * sizeof( T ) );
+				}
+
+				explicit shared_vector( vector_type values ): m_values( ), m_alloc( values.get_allocator( ) ) {
+					m_values = std::allocate_shared<vector_type>( m_alloc, std::move( values ) );
+					DAW_RANGE_ALLOCATION( m_values->capacity( ) * sizeof( T ) );
+				}
+
+				const vector_type& get( ) const {
+					if( !m_values ) {
+						return empty_values( );
+					}
+					return *m_values;
+				}
+
+				vector_type& mut( ) {
+					if( !m_values ) {
+						m_values = std::allocate_shared<vector_type>( m_alloc, m_alloc );
+					} else if( !is_unique( ) ) {
+						m_values = std::allocate_shared<vector_type>( m_alloc, *m_values );
+						DAW_RANGE_ALLOCATION( m_values->capacity( ) * sizeof( T ) );
+					}
+					return *m_values;
+				}
+
+				bool is_unique( ) const {
+					return !m_values || 1 == m_values.use_count( );
+				}
+
+				bool shares_with( const shared_vector& other ) const {
+					return m_values == other.m_values;
+				}
+
+				void clear( ) {
+					m_values.reset( );
+				}
+
+				allocator_type get_allocator( ) const {
+					return m_alloc;
+				}
+
+			private:
+				std::shared_ptr<vector_type> m_values;
+				Allocator m_alloc;
+
+				static const vector_type& empty_values( ) {
+					static const vector_type result;
+					return result;
+				}
+			};	// class shared_vector
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Counts the writes made to the values through a range.  Every
+			/// range copied from the same one shares the count, so a lookup index
+			/// built by one of them can tell it is stale after another writes
+			struct write_counter {
+				write_counter( ): m_writes( std::make_shared<std::atomic<uint64_t>>( 0 ) ) { }
+
+				// Copied instead of moved so a moved from range still has a count
+				write_counter( const write_counter& ) = default;
+				write_counter& operator=(const write_counter&) = default;
+
+				uint64_t write_count( ) const {
+					return m_writes->load( );
+				}
+
+				void record_write( ) const {
+					++*m_writes;
+				}
+
+			private:
+				std::shared_ptr<std::atomic<uint64_t>> m_writes;
+			};	// struct write_counter
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Storage of a FilteredRange that keeps a reference to each
+			/// value.  Works with any source container
+			template<typename value_type>
+			struct ref_storage: public write_counter {
+				using element_type = std::reference_wrapper<value_type>;
+
+				ref_storage( ) { }
+
+				template<typename Iter>
+				ref_storage( Iter, Iter ) { }
+
+				value_type& deref( const element_type& element ) const {
+					return element.get( );
+				}
+
+				bool same_source( const ref_storage& ) const {
+					return true;
+				}
+
+				template<typename Elements, typename Iter>
+				void append( Elements& elements, Iter first_inclusive, Iter last_exclusive ) const {
+					for( auto it = first_inclusive; it != last_exclusive; ++it ) {
+						elements.push_back( element_type( *it ) );
+					}
+				}
+			};	// struct ref_storage
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Storage of a FilteredRange that keeps the position of each 
+			/// value relative to the start of a random access source.  A uint32_t
+			/// Index is half the size of a reference on 64-bit platforms
+			template<typename value_type, typename RandomIter, typename Index>
+			struct index_storage: public write_counter {
+				using element_type = Index;
+				RandomIter first;
+				RandomIter last;
+
+				index_storage( RandomIter first_inclusive, RandomIter last_exclusive ): first( first_inclusive ), last( last_exclusive ) { }
+
+				value_type& deref( element_type element ) const {
+					return first[element];
+				}
+
+				bool same_source( const index_storage& other ) const {
+					return last - first == other.last - other.first && (first == last || std::addressof( *first ) == std::addressof( *other.first ));
+				}
+
+				// Only values from the same source can be appended.  They are found
+				// by address, as comparing iterators of another container is undefined
+				template<typename Elements>
+				void append( Elements& elements, RandomIter first_inclusive, RandomIter last_exclusive ) const {
+					auto const count = static_cast<uint64_t>(last_exclusive - first_inclusive);
+					if( 0 == count ) {
+						return;
+					}
+					auto const size = static_cast<uint64_t>(last - first);
+					auto const pos = static_cast<uint64_t>(position_of( *first_inclusive ));
+					if( pos >= size || count > size - pos || std::addressof( first[static_cast<size_t>(pos + count - 1)] ) != std::addressof( *(last_exclusive - 1) ) ) {
+						throw std::out_of_range( "index_storage can only append values from its own source" );
+					}
+					auto const max_index = static_cast<uint64_t>(std::numeric_limits<Index>::max( ));
+					if( pos > max_index || count - 1 > max_index - pos ) {
+						throw std::length_error( "Index type is too small for the size of the source" );
+					}
+					for( uint64_t n = 0; n < count; ++n ) {
+						elements.push_back( static_cast<Index>(pos + n) );
+					}
+				}
+
+			private:
+				// The position of value in the source, or its size when value is not
+				// in it.  Sources laid out contiguously are checked by address, others
+				// such as a std::deque are searched
+				size_t position_of( const value_type& value ) const {
+					auto const size = static_cast<size_t>(last - first);
+					if( 0 == size ) {
+						return size;
+					}
+					auto const ptr = std::addressof( value );
+					auto const front = std::addressof( *first );
+					auto const back = std::addressof( first[size - 1] );
+					auto const span = reinterpret_cast<uintptr_t>(back) - reinterpret_cast<uintptr_t>(front);
+					if( span == (size - 1) * sizeof( value_type ) ) {
+						std::less<const value_type*> less;
+						if( less( ptr, front ) || less( back, ptr ) ) {
+							return size;
+						}
+						auto const pos = static_cast<size_t>((reinterpret_cast<uintptr_t>(ptr) - reinterpret_cast<uintptr_t>(front)) / sizeof( value_type ));
+						return std::addressof( first[pos] ) == ptr ? pos : size;
+					}
+					for( size_t pos = 0; pos < size; ++pos ) {
+						if( std::addressof( first[pos] ) == ptr ) {
+							return pos;
+						}
+					}
+					return size;
+				}
+			};	// struct index_storage
+
+			// Adapts a function on values to one on the elements of Storage
+			template<typename Storage, typename Func>
+			struct deref_func {
+				Storage storage;
+				Func func;
+
+				deref_func( Storage s, Func f ): storage( std::move( s ) ), func( std::move( f ) ) { }
+
+				template<typename ...Elements>
+				auto operator()( const Elements&... elements ) -> decltype(func( storage.deref( elements )... )) {
+					return func( storage.deref( elements )... );
+				}
+
+				template<typename ...Elements>
+				auto operator()( const Elements&... elements ) const -> decltype(func( storage.deref( elements )... )) {
+					return func( storage.deref( elements )... );
+				}
+			};
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: A membership index over the filtered elements of a range
+			template<typename value_type>
+			class value_lookup {
+			public:
+				virtual ~value_lookup( ) = default;
+				virtual bool contains( const value_type& value ) const = 0;
+			};
+
+			// Expected O(1) lookups with std::hash
+			template<typename value_type, typename Storage>
+			class hash_lookup: public value_lookup<value_type> {
+			public:
+				using element_type = typename Storage::element_type;
+
+				template<typename Elements>
+				hash_lookup( const Storage& storage, const Elements& elements ): m_storage( storage ), m_table( elements.size( ), hash_type( storage, std::hash<value_type>( ) ), equal_type( storage, std::equal_to<value_type>( ) ) ) {
+					for( auto& element : elements ) {
+						m_table.insert( element );
+					}
+				}
+
+				bool contains( const value_type& value ) const override {
+					auto const & storage = m_storage;
+					return m_table.contains_hashed( static_cast<uint64_t>(std::hash<value_type>( )( value )), [&storage, &value]( const element_type& element ) { return storage.deref( element ) == value; } );
+				}
+
+			private:
+				using hash_type = deref_func<Storage, std::hash<value_type>>;
+				using equal_type = deref_func<Storage, std::equal_to<value_type>>;
+				Storage m_storage;
+				open_hash_table<element_type, hash_type, equal_type> m_table;
+			};	// class hash_lookup
+
+			// O(log n) lookups in the elements sorted by operator<
+			template<typename value_type, typename Storage>
+			class sorted_lookup: public value_lookup<value_type> {
+			public:
+				using element_type = typename Storage::element_type;
+
+				template<typename Elements>
+				sorted_lookup( const Storage& storage, const Elements& elements ): m_storage( storage ), m_elements( elements.begin( ), elements.end( ) ) {
+					if( !radix_sort<value_type>( m_elements, storage, std::less<value_type>( ) ) ) {
+						std::sort( m_elements.begin( ), m_elements.end( ), deref_func<Storage, std::less<value_type>>( storage, std::less<value_type>( ) ) );
+					}
+				}
+
+				bool contains( const value_type& value ) const override {
+					auto const & storage = m_storage;
+					auto it = std::lower_bound( m_elements.begin( ), m_elements.end( ), value, [&storage]( const element_type& element, const value_type& rhs ) { return storage.deref( element ) < rhs; } );
+					return it != m_elements.end( ) && !(value < storage.deref( *it ));
+				}
+
+			private:
+				Storage m_storage;
+				std::vector<element_type> m_elements;
+			};	// class sorted_lookup
+
+			// Neither hashable nor ordered, so every lookup scans
+			template<typename value_type, typename Storage>
+			class scan_lookup: public value_lookup<value_type> {
+			public:
+				using element_type = typename Storage::element_type;
+
+				template<typename Elements>
+				scan_lookup( const Storage& storage, const Elements& elements ): m_storage( storage ), m_elements( elements.begin( ), elements.end( ) ) { }
+
+				bool contains( const value_type& value ) const override {
+					for( auto& element : m_elements ) {
+						if( m_storage.deref( element ) == value ) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+			private:
+				Storage m_storage;
+				std::vector<element_type> m_elements;
+			};	// class scan_lookup
+
+			template<typename value_type, typename Storage, typename Elements>
+			std::unique_ptr<value_lookup<value_type>> make_lookup( const Storage& storage, const Elements& elements, std::integral_constant<int, 2> ) {
+				return std::unique_ptr<value_lookup<value_type>>( new hash_lookup<value_type, Storage>( storage, elements ) );
+			}
+
+			template<typename value_type, typename Storage, typename Elements>
+			std::unique_ptr<value_lookup<value_type>> make_lookup( const Storage& storage, const Elements& elements, std::integral_constant<int, 1> ) {
+				return std::unique_ptr<value_lookup<value_type>>( new sorted_lookup<value_type, Storage>( storage, elements ) );
+			}
+
+			template<typename value_type, typename Storage, typename Elements>
+			std::unique_ptr<value_lookup<value_type>> make_lookup( const Storage& storage, const Elements& elements, std::integral_constant<int, 0> ) {
+				return std::unique_ptr<value_lookup<value_type>>( new scan_lookup<value_type, Storage>( storage, elements ) );
+			}
+
+			// Picks the best index value_type supports
+			template<typename value_type, typename Storage, typename Elements>
+			std::unique_ptr<value_lookup<value_type>> make_lookup( const Storage& storage, const Elements& elements ) {
+				return make_lookup<value_type>( storage, elements, std::integral_constant<int, is_hashable<value_type>::value ? 2 : is_less_comparable<value_type>::value ? 1 : 0>( ) );
+			}
+
+			// An address unique to T, used to tell comparator types apart
+			template<typename T>
+			const void* type_key( ) {
+				static const char key = 0;
+				return &key;
+			}
+
+			// First position in [first, last) not less than value, probing at
+			// exponentially growing distances before the binary search
+			template<typename RandomIter, typename T, typename Compare>
+			RandomIter gallop_lower_bound( RandomIter first, RandomIter last, const T& value, Compare& comp ) {
+				auto const size = last - first;
+				decltype(last - first) bound = 1;
+				while( bound < size && comp( first[bound], value ) ) {
+					bound *= 2;
+				}
+				return std::lower_bound( first + bound / 2, first + std::min( bound + 1, size ), value, comp );
+			}
+
+			// First position in [first, last) greater than value
+			template<typename RandomIter, typename T, typename Compare>
+			RandomIter gallop_upper_bound( RandomIter first, RandomIter last, const T& value, Compare& comp ) {
+				auto const size = last - first;
+				decltype(last - first) bound = 1;
+				while( bound < size && !comp( value, first[bound] ) ) {
+					bound *= 2;
+				}
+				return std::upper_bound( first + bound / 2, first + std::min( bound + 1, size ), value, comp );
+			}
+
+			// Above this size ratio intersection gallops through the larger input
+			static const size_t gallop_ratio = 32;
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Same output as std::set_intersection.  When one input is
+			/// much smaller, each run of equal values in it is located in the other
+			/// with gallop_lower_bound, so the cost grows with the small size times
+			/// the log of the large one.
+			template<typename T, typename Alloc, typename Compare>
+			void sorted_intersection( const std::vector<T, Alloc>& lhs, const std::vector<T, Alloc>& rhs, std::vector<T, Alloc>& out, Compare comp ) {
+				auto const lhs_small = lhs.size( ) * gallop_ratio < rhs.size( );
+				if( !lhs_small && rhs.size( ) * gallop_ratio >= lhs.size( ) ) {
+					std::set_intersection( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), std::back_inserter( out ), comp );
+					return;
+				}
+				auto const & small = lhs_small ? lhs : rhs;
+				auto const & large = lhs_small ? rhs : lhs;
+				auto large_pos = large.begin( );
+				auto small_pos = small.begin( );
+				while( small_pos != small.end( ) && large_pos != large.end( ) ) {
+					auto small_last = small_pos + 1;
+					while( small_last != small.end( ) && !comp( *small_pos, *small_last ) ) {
+						++small_last;
+					}
+					auto const large_first = gallop_lower_bound( large_pos, large.end( ), *small_pos, comp );
+					large_pos = gallop_upper_bound( large_first, large.end( ), *small_pos, comp );
+					auto const count = std::min( small_last - small_pos, large_pos - large_first );
+					// Like std::set_intersection the values come from lhs
+					auto const from = lhs_small ? small_pos : large_first;
+					out.insert( out.end( ), from, from + count );
+					small_pos = small_last;
+				}
+			}
+		}	// namespace impl
+
+		template<typename value_type, typename Storage = impl::ref_storage<value_type>>
 		class FilteredRange {
 		public:			
+			using element_type = typename Storage::element_type;
 
 			template<typename Iter>
-			FilteredRange( Iter first_inclusive, Iter last_exclusive ): m_value_refs( first_inclusive, last_exclusive ), m_pred_include( ) { }
+			FilteredRange( Iter first_inclusive, Iter last_exclusive ): m_storage( first_inclusive, last_exclusive ), m_value_refs( ), m_pred_include( ), m_sorted_by( nullptr ), m_lookup( ), m_use_lookup( false ), m_adaptive( ) {
+				auto elements = new_elements( );
+				m_storage.append( elements, first_inclusive, last_exclusive );
+				m_value_refs = impl::shared_vector<element_type, element_allocator>( std::move( elements ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Constructs a range over [first, last) whose elements are
+			/// kept by storage
+			template<typename Iter>
+			FilteredRange( Storage storage, Iter first_inclusive, Iter last_exclusive ): m_storage( std::move( storage ) ), m_value_refs( ), m_pred_include( ), m_sorted_by( nullptr ), m_lookup( ), m_use_lookup( false ), m_adaptive( ) {
+				auto elements = new_elements( );
+				m_storage.append( elements, first_inclusive, last_exclusive );
+				m_value_refs = impl::shared_vector<element_type, element_allocator>( std::move( elements ) );
+			}
 
 			FilteredRange& operator=(FilteredRange rhs) {
+				m_storage = std::move( rhs.m_storage );
 				m_value_refs = std::move( rhs.m_value_refs );
 				m_pred_include = std::move( rhs.m_pred_include );
+				m_sorted_by = rhs.m_sorted_by;
+				m_lookup = std::move( rhs.m_lookup );
+				m_use_lookup = rhs.m_use_lookup;
+				m_adaptive = rhs.m_adaptive;
 				return *this;
 			}
 
-			FilteredRange( FilteredRange&& other ): m_value_refs( std::move( other.m_value_refs ) ), m_pred_include( std::move( other.m_pred_include ) ) { }
+			FilteredRange( FilteredRange&& other ): m_storage( std::move( other.m_storage ) ), m_value_refs( std::move( other.m_value_refs ) ), m_pred_include( std::move( other.m_pred_include ) ), m_sorted_by( other.m_sorted_by ), m_lookup( std::move( other.m_lookup ) ), m_use_lookup( other.m_use_lookup ), m_adaptive( other.m_adaptive ) { }
 			FilteredRange( ) = delete;
 			FilteredRange( const FilteredRange& ) = default;
 
 			virtual ~FilteredRange( ) = default;
 
-			using predicate_type = std::function < bool( value_type ) >;
+			using predicate_type = std::function < bool( const value_type& ) >;
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Adds a predicate that when false for a value 
 			/// filters out the value.  
 			FilteredRange where( predicate_type predicate ) const {
 				auto result = copy_of_me( );
-				result.m_pred_include.push_back( predicate );
+				result.m_pred_include.mut( ).push_back( std::move( predicate ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Adds a predicate and filters right away, evaluating all
+			/// predicates on the threads of policy.  The range is split into chunks
+			/// of policy.chunk_size( ) values that idle threads steal from busy
+			/// ones, so expensive predicates scale with the thread count.  The
+			/// survivors keep their order.
+			FilteredRange where( const execution::policy& policy, predicate_type predicate ) const {
+				DAW_RANGE_OPERATION( "where", m_value_refs.get( ).size( ) );
+				auto result = where( std::move( predicate ) ).do_filter( policy );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 			
@@ -54,34 +491,88 @@ namespace daw {
 			/// Summary: On every valid element do something
 			template<typename Func>
 			FilteredRange for_each( Func func ) const {
+				DAW_RANGE_OPERATION( "for_each", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				for( const auto current_value : result.m_value_refs ) {
-					func( current_value );
+				for( auto& current_value : result.m_value_refs.get( ) ) {
+					func( deref( current_value ) );
 				}
+				m_storage.record_write( );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: On every valid element do something, on the threads of
+			/// policy.  func is called concurrently and in no particular order
+			template<typename Func>
+			FilteredRange for_each( const execution::policy& policy, Func func ) const {
+				DAW_RANGE_OPERATION( "for_each", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( policy );
+				auto const & values = result.m_value_refs.get( );
+				impl::parallel_for_chunks( policy, values.size( ), [&]( size_t first, size_t last ) {
+					for( auto pos = first; pos < last; ++pos ) {
+						func( result.deref( values[pos] ) );
+					}
+				} );
+				m_storage.record_write( );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Copy all valid values to a std::vector
 			std::vector<value_type> to_vector( ) {
+				return to_vector( std::allocator<value_type>( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Copy all valid values to a std::vector that allocates with
+			/// alloc, such as a resource_allocator
+			template<typename Allocator>
+			std::vector<value_type, Allocator> to_vector( const Allocator& alloc ) {
+				auto result = std::vector<value_type, Allocator>( alloc );
+				result.reserve( size_hint( ) );
+				into( std::back_inserter( result ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Move all valid values out of the source into a std::vector.
+			/// The values left in the source are valid but unspecified, like any
+			/// moved from object
+			std::vector<value_type> move_to_vector( ) {
 				auto result = std::vector<value_type>( );
-				auto filt_iters = get_filtered_iterators( );
-				for( auto it = filt_iters.first; it != filt_iters.second; ++it ) {
-					result.push_back( it->get( ) );
-				}
+				result.reserve( size_hint( ) );
+				each_included( [&result]( value_type& value ) {
+					result.push_back( std::move( value ) );
+					return true;
+				} );
 				return result;
 			}
 
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Copy all valid values to out_it, such as a back_inserter, and
+			/// return the position after the last one written
+			template<typename OutputIter>
+			OutputIter into( OutputIter out_it ) const {
+				each_included( [&out_it]( const value_type& value ) {
+					*out_it++ = value;
+					return true;
+				} );
+				return out_it;
+			}
+
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Copy all valid values to the provided range up to the
 			/// smallest list.
 			template<typename Iter>
 			FilteredRange copy_to( Iter first_inclusive, Iter last_exclusive ) {				
-				auto filt_iter = get_filtered_iterators( );
-				auto in_it = filt_iter.first;
 				auto out_it = first_inclusive;
-				while( in_it != filt_iter.second && out_it != last_exclusive ) {
-					*out_it++ = *in_it++;
+				if( out_it != last_exclusive ) {
+					each_included( [&out_it, &last_exclusive]( value_type& value ) {
+						*out_it++ = value;
+						return out_it != last_exclusive;
+					} );
 				}
 				return copy_of_me( );
 			}
@@ -91,9 +582,8 @@ namespace daw {
 			template<typename Iter>
 			FilteredRange append( Iter first_inclusive, Iter last_exclusive ) const {
 				auto result = copy_of_me( );
-				for( auto it = first_inclusive; it != last_exclusive; ++it ) {
-					result.m_value_refs.push_back( std::reference_wrapper<value_type>( *it ) );
-				}
+				m_storage.append( result.m_value_refs.mut( ), first_inclusive, last_exclusive );
+				result.m_sorted_by = nullptr;
 				return result;
 			}
 
@@ -101,22 +591,62 @@ namespace daw {
 			/// Summary: Sort the elements in the range into ascending order.
 			/// The elements are compared using operator< or the optional comp.
 			/// Equivalent elements are not guaranteed to keep their original 
-			/// relative order (see stable_sort)
+			/// relative order (see stable_sort).  Integral and floating point
+			/// values ordered by std::less or std::greater are radix sorted
 			template<typename LessThanCompare = std::less<value_type>>
 			FilteredRange sort( LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "sort", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				std::sort( result.begin( ), result.end( ), comp );
+				if( !result.is_sorted_by( comp ) ) {
+					if( !impl::radix_sort<value_type>( result.m_value_refs.mut( ), m_storage, comp ) ) {
+						std::sort( result.begin( ), result.end( ), by_value( comp ) );
+					}
+					result.template mark_sorted<LessThanCompare>( );
+				}
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sort the elements using the threads of policy.  Runs a
+			/// parallel stable merge sort, so the order of equivalent elements is
+			/// the same as stable_sort's
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange sort( const execution::policy& policy, LessThanCompare comp = LessThanCompare( ) ) const {
+				return stable_sort( policy, comp );
+			}
+
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Sort the elements in the range into ascending order.
 			/// The elements are compared using operator< or the optional comp.
-			/// Preserves the relative order of the elements with equivalent values
+			/// Preserves the relative order of the elements with equivalent values.
+			/// The radix sort used by sort is stable, so it is used here too
 			template<typename EqualToCompare = std::less<value_type>>
 			FilteredRange stable_sort( EqualToCompare comp = EqualToCompare( ) ) const {
+				DAW_RANGE_OPERATION( "stable_sort", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				std::stable_sort( result.begin( ), result.end( ), comp );
+				if( !result.is_sorted_by( comp ) ) {
+					if( !impl::radix_sort<value_type>( result.m_value_refs.mut( ), m_storage, comp ) ) {
+						std::stable_sort( result.begin( ), result.end( ), by_value( comp ) );
+					}
+					result.template mark_sorted<EqualToCompare>( );
+				}
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Stable sort using the threads of policy.  The result is the
+			/// same as stable_sort( comp )
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange stable_sort( const execution::policy& policy, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "stable_sort", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( policy );
+				if( !result.is_sorted_by( comp ) ) {
+					impl::parallel_stable_sort( policy, result.m_value_refs.mut( ), by_value( comp ) );
+					result.template mark_sorted<LessThanCompare>( );
+				}
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -124,9 +654,11 @@ namespace daw {
 			/// Summary: Removes all consecutive duplicate elements from the range
 			template<typename EqualToCompare = std::equal_to<value_type>>
 			FilteredRange unique( EqualToCompare comp = EqualToCompare( ) ) const {
+				DAW_RANGE_OPERATION( "unique", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				auto new_last = std::unique( result.begin( ), result.end( ), comp );
-				result.m_value_refs.erase( new_last, result.end( ) );
+				auto new_last = std::unique( result.begin( ), result.end( ), by_value( comp ) );
+				result.m_value_refs.mut( ).erase( new_last, result.end( ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -135,25 +667,56 @@ namespace daw {
 			/// elements
 			template<typename EqualToCompare = std::less<value_type>, typename EqualCompare = std::equal_to<value_type>>
 			FilteredRange sorted_unique( EqualToCompare scomp = EqualToCompare( ), EqualCompare ucomp = EqualCompare( ) ) const {
+				DAW_RANGE_OPERATION( "sorted_unique", m_value_refs.get( ).size( ) );
 				auto result = sort( scomp );
-				auto new_last = std::unique( result.begin( ), result.end( ), ucomp );
-				result.m_value_refs.erase( new_last, result.end( ) );
+				auto new_last = std::unique( result.begin( ), result.end( ), by_value( ucomp ) );
+				result.m_value_refs.mut( ).erase( new_last, result.end( ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: sorted_unique using the threads of policy for both the sort
+			/// and the removal of duplicates
+			template<typename LessThanCompare = std::less<value_type>, typename EqualCompare = std::equal_to<value_type>>
+			FilteredRange sorted_unique( const execution::policy& policy, LessThanCompare scomp = LessThanCompare( ), EqualCompare ucomp = EqualCompare( ) ) const {
+				DAW_RANGE_OPERATION( "sorted_unique", m_value_refs.get( ).size( ) );
+				auto result = sort( policy, scomp );
+				impl::parallel_unique( policy, result.m_value_refs.mut( ), by_value( ucomp ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Removes all duplicate elements from the range maintaining order.
 			/// After the initial element, no other duplicates are included.
+			/// Uses a hash set when comp is std::equal_to and std::hash is available
+			/// for value_type, otherwise compares against every kept value.
 			template<typename EqualToCompare = std::equal_to<value_type>>
 			FilteredRange stable_unique( EqualToCompare comp = EqualToCompare( ) ) const {
-				auto result = std::vector<std::reference_wrapper<value_type>>( );
-				for( auto& current_value : m_value_refs ) {
-					if( value_included( current_value ) && result.end( ) == find( result.begin( ), result.end( ), current_value, comp ) ) {
-						result.push_back( current_value );
+				DAW_RANGE_OPERATION( "stable_unique", m_value_refs.get( ).size( ) );
+				auto result = stable_unique_impl( comp, use_hash<EqualToCompare>( ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Removes all duplicate elements from the range maintaining order
+			/// in expected linear time.  Values that are equal by comp must have the
+			/// same hash.
+			template<typename Hash, typename EqualToCompare>
+			FilteredRange stable_unique( Hash hash, EqualToCompare comp ) const {
+				DAW_RANGE_OPERATION( "stable_unique", m_value_refs.get( ).size( ) );
+				auto const & values = m_value_refs.get( );
+				auto table = impl::open_hash_table<element_type, impl::deref_func<Storage, Hash>, impl::deref_func<Storage, EqualToCompare>, element_allocator>( values.size( ), by_value( hash ), by_value( comp ), m_value_refs.get_allocator( ) );
+				for( auto& current_value : values ) {
+					if( value_included( deref( current_value ) ) ) {
+						table.insert( current_value );
 					}
 				}
-				auto retval = FilteredRange( result, m_pred_include );
-				return retval;
+				auto result = FilteredRange( table.release_keys( ), m_pred_include, m_storage );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
@@ -165,11 +728,23 @@ namespace daw {
 			/// group.
 			template<typename UnaryPredicate = std::less<value_type>>
 			FilteredRange partition( UnaryPredicate pred = UnaryPredicate( ) ) const {
+				DAW_RANGE_OPERATION( "partition", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				std::partition( result.begin( ), result.end( ), pred );
+				std::partition( result.begin( ), result.end( ), by_value( pred ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Partition using the threads of policy.  pred is evaluated
+			/// in parallel and the groups keep their relative order, as with
+			/// stable_partition
+			template<typename UnaryPredicate>
+			FilteredRange partition( const execution::policy& policy, UnaryPredicate pred ) const {
+				return stable_partition( policy, pred );
+			}
+
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Rearranges the elements of the range in such a way that 
 			/// all the elements for which pred returns true precede all those for
@@ -177,19 +752,141 @@ namespace daw {
 			/// group is preserved.
 			template<typename UnaryPredicate = std::less<value_type>>
 			FilteredRange stable_partition( UnaryPredicate pred = UnaryPredicate( ) ) const {
+				DAW_RANGE_OPERATION( "stable_partition", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				std::stable_partition( result.begin( ), result.end( ), pred );
+				std::stable_partition( result.begin( ), result.end( ), by_value( pred ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Stable partition using the threads of policy.  The result
+			/// is the same as stable_partition( pred )
+			template<typename UnaryPredicate>
+			FilteredRange stable_partition( const execution::policy& policy, UnaryPredicate pred ) const {
+				DAW_RANGE_OPERATION( "stable_partition", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( policy );
+				impl::parallel_stable_partition( policy, result.m_value_refs.mut( ), by_value( pred ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Reverses the order of the elements in the range
 			FilteredRange reverse( ) const {
+				DAW_RANGE_OPERATION( "reverse", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
 				std::reverse( result.begin( ), result.end( ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Reverses the order of the elements using the threads of
+			/// policy
+			FilteredRange reverse( const execution::policy& policy ) const {
+				DAW_RANGE_OPERATION( "reverse", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( policy );
+				impl::parallel_reverse( policy, result.m_value_refs.mut( ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Constructs a new range with the k smallest values by comp in
+			/// ascending order.  The values are streamed through a bounded heap, so
+			/// only k elements are held at any time
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange top_k( size_t k, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "top_k", m_value_refs.get( ).size( ) );
+				auto const & values = m_value_refs.get( );
+				auto heap = new_elements( );
+				if( is_sorted_by( comp ) ) {
+					for( auto it = values.begin( ); it != values.end( ) && heap.size( ) < k; ++it ) {
+						if( value_included( deref( *it ) ) ) {
+							heap.push_back( *it );
+						}
+					}
+				} else if( 0 != k ) {
+					auto const elem_comp = by_value( comp );
+					heap.reserve( std::min( k, values.size( ) ) );
+					for( auto& current_value : values ) {
+						if( !value_included( deref( current_value ) ) ) {
+							continue;
+						}
+						if( heap.size( ) < k ) {
+							heap.push_back( current_value );
+							std::push_heap( heap.begin( ), heap.end( ), elem_comp );
+						} else if( elem_comp( current_value, heap.front( ) ) ) {
+							// Replace the largest of the k kept so far
+							std::pop_heap( heap.begin( ), heap.end( ), elem_comp );
+							heap.back( ) = current_value;
+							std::push_heap( heap.begin( ), heap.end( ), elem_comp );
+						}
+					}
+					std::sort_heap( heap.begin( ), heap.end( ), elem_comp );
+				}
+				auto result = FilteredRange( std::move( heap ), { }, m_storage );
+				result.template mark_sorted<LessThanCompare>( );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Rearranges the range so that its first k elements are the
+			/// k smallest by comp in ascending order.  The order of the rest is
+			/// unspecified
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange partial_sort( size_t k, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "partial_sort", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( );
+				if( !result.is_sorted_by( comp ) ) {
+					auto const middle = result.begin( ) + static_cast<std::ptrdiff_t>(std::min( k, result.m_value_refs.get( ).size( ) ));
+					std::partial_sort( result.begin( ), middle, result.end( ), by_value( comp ) );
+					result.m_sorted_by = nullptr;
+				}
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Rearranges the range so that the nth element is the one
+			/// that would be there if the range were sorted by comp, no element
+			/// before it is greater and no element after it is less
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange nth_element( size_t n, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "nth_element", m_value_refs.get( ).size( ) );
+				auto result = copy_of_me( ).do_filter( );
+				if( n < result.m_value_refs.get( ).size( ) && !result.is_sorted_by( comp ) ) {
+					std::nth_element( result.begin( ), result.begin( ) + static_cast<std::ptrdiff_t>(n), result.end( ), by_value( comp ) );
+					result.m_sorted_by = nullptr;
+				}
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns the median value by comp.  With an even number of
+			/// values the lower of the two middle values is returned.  Throws
+			/// std::out_of_range when the range is empty
+			template<typename LessThanCompare = std::less<value_type>>
+			value_type median( LessThanCompare comp = LessThanCompare( ) ) const {
+				auto result = copy_of_me( ).do_filter( );
+				auto const size = result.m_value_refs.get( ).size( );
+				if( 0 == size ) {
+					throw std::out_of_range( "median of an empty range" );
+				}
+				auto const middle = result.begin( ) + static_cast<std::ptrdiff_t>((size - 1) / 2);
+				if( !result.is_sorted_by( comp ) ) {
+					std::nth_element( result.begin( ), middle, result.end( ), by_value( comp ) );
+				}
+				return deref( *middle );
+			}
+
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Rearranges the elements in the range randomly.  The 
 			/// function swaps the value of each element with that of some other 
@@ -197,8 +894,11 @@ namespace daw {
 			/// picked in every case.
 			template<typename RandomNumberGenerator>
 			FilteredRange random_shuffle( RandomNumberGenerator rnd ) const {
+				DAW_RANGE_OPERATION( "random_shuffle", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
 				std::random_shuffle( result.begin( ), result.end( ), rnd );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -208,8 +908,11 @@ namespace daw {
 			/// randomly picked element.  The function uses some unspecified 
 			/// source of randomness
 			FilteredRange random_shuffle( ) const {
+				DAW_RANGE_OPERATION( "random_shuffle", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
 				std::random_shuffle( result.begin( ), result.end( ) );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -219,12 +922,15 @@ namespace daw {
 			/// the elements, otherwise it uses the given binary predicate comp. 
 			template<typename EqualToCompare = std::equal_to<value_type>>
 			FilteredRange replace( const value_type& old_value, const value_type& new_value, EqualToCompare comp = EqualToCompare( ) ) const {
+				DAW_RANGE_OPERATION( "replace", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
 				result.for_each( [&old_value, &new_value, &comp]( value_type& current_value ) {
 					if( comp( old_value, current_value ) ) {
 						current_value = new_value;
 					}
 				} );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -233,8 +939,15 @@ namespace daw {
 			/// new_value in the range.
 			template<typename UnaryPredicate>
 			FilteredRange replace_if( UnaryPredicate pred, value_type new_value ) const {
+				DAW_RANGE_OPERATION( "replace_if", m_value_refs.get( ).size( ) );
 				auto result = copy_of_me( ).do_filter( );
-				std::replace_if( result.begin( ), result.end( ), pred, new_value );
+				result.for_each( [&pred, &new_value]( value_type& current_value ) {
+					if( pred( current_value ) ) {
+						current_value = new_value;
+					}
+				} );
+				result.m_sorted_by = nullptr;
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -242,28 +955,30 @@ namespace daw {
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Constructs a new range with the union of two 
 			/// FilteredRange's formed by the elements that are present in either one, 
-			/// or in both. 
+			/// or in both.  The result is sorted by comp.  Inputs already sorted by
+			/// the same stateless comparator type are merged without sorting.
 			template<typename LessThanCompare = std::less<value_type>>
-			FilteredRange set_union( FilteredRange other, LessThanCompare comp = LessThanCompare( ) ) const {
-				auto result = copy_of_me( ).do_filter( ).sort( );
-				other.do_filter( ).sort( );
-				m_pred_include.insert( m_pred_include.end( ), other.m_pred_include.begin( ), other.m_pred_include.end( ) );	
-				auto new_last = std::set_union( result.begin( ), result.end( ), other.begin( ), other.end( ), comp );
-				result.m_value_refs.erase( new_last, result.end( ) );
+			FilteredRange set_union( const FilteredRange& other, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "set_union", m_value_refs.get( ).size( ) + other.m_value_refs.get( ).size( ) );
+				auto result = merge_sorted( other, comp, []( const element_vector& lhs, const element_vector& rhs, element_vector& out, const impl::deref_func<Storage, LessThanCompare>& elem_comp ) {
+					std::set_union( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), std::back_inserter( out ), elem_comp );
+				} );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Constructs a new range with the intersection of two 
 			/// FilteredRange's formed by only by the elements that are present
-			/// in both
+			/// in both.  When one input is much smaller the other is searched with
+			/// exponential steps instead of being walked.
 			template<typename LessThanCompare = std::less<value_type>>
-			FilteredRange set_intersection( FilteredRange other, LessThanCompare comp = LessThanCompare( ) ) const {
-				auto result = copy_of_me( ).do_filter( ).sort( );
-				other.do_filter( ).sort( );
-				m_pred_include.insert( m_pred_include.end( ), other.m_pred_include.begin( ), other.m_pred_include.end( ) );
-				auto new_last = std::set_intersection( result.begin( ), result.end( ), other.begin( ), other.end( ), comp );
-				result.m_value_refs.erase( new_last, result.end( ) );
+			FilteredRange set_intersection( const FilteredRange& other, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "set_intersection", m_value_refs.get( ).size( ) + other.m_value_refs.get( ).size( ) );
+				auto result = merge_sorted( other, comp, []( const element_vector& lhs, const element_vector& rhs, element_vector& out, const impl::deref_func<Storage, LessThanCompare>& elem_comp ) {
+					impl::sorted_intersection( lhs, rhs, out, elem_comp );
+				} );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -272,12 +987,12 @@ namespace daw {
 			/// FilteredRange's formed by the elements that are present in the first 
 			/// set, but not in the second one
 			template<typename LessThanCompare = std::less<value_type>>
-			FilteredRange set_difference( FilteredRange other, LessThanCompare comp = LessThanCompare( ) ) const {
-				auto result = copy_of_me( ).do_filter( ).sort( );
-				other.do_filter( ).sort( );
-				m_pred_include.insert( m_pred_include.end( ), other.m_pred_include.begin( ), other.m_pred_include.end( ) );
-				auto new_last = std::set_difference( result.begin( ), result.end( ), other.begin( ), other.end( ) );
-				result.m_value_refs.erase( new_last, result.end( ) );
+			FilteredRange set_difference( const FilteredRange& other, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "set_difference", m_value_refs.get( ).size( ) + other.m_value_refs.get( ).size( ) );
+				auto result = merge_sorted( other, comp, []( const element_vector& lhs, const element_vector& rhs, element_vector& out, const impl::deref_func<Storage, LessThanCompare>& elem_comp ) {
+					std::set_difference( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), std::back_inserter( out ), elem_comp );
+				} );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -285,34 +1000,26 @@ namespace daw {
 			/// Summary: Constructs a new range with the difference of two 
 			/// FilteredRange's formed by the elements that are present one of the
 			/// sets but not the other
-			FilteredRange set_symmetric_difference( FilteredRange other ) const {
-				auto result = copy_of_me( ).do_filter( ).sort( );
-				other.do_filter( ).sort( );
-				m_pred_include.insert( m_pred_include.end( ), other.m_pred_include.begin( ), other.m_pred_include.end( ) );
-				auto new_last = std::set_symmetric_difference( result.begin( ), result.end( ), other.begin( ), other.end( ) );
-				result.m_value_refs.erase( new_last, result.end( ) );
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRange set_symmetric_difference( const FilteredRange& other, LessThanCompare comp = LessThanCompare( ) ) const {
+				DAW_RANGE_OPERATION( "set_symmetric_difference", m_value_refs.get( ).size( ) + other.m_value_refs.get( ).size( ) );
+				auto result = merge_sorted( other, comp, []( const element_vector& lhs, const element_vector& rhs, element_vector& out, const impl::deref_func<Storage, LessThanCompare>& elem_comp ) {
+					std::set_symmetric_difference( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ), std::back_inserter( out ), elem_comp );
+				} );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
 			/// Summary: Constructs a new range with the sorted values that have 
-			/// duplicates
+			/// duplicates.  Values are counted in a hash table when comp is
+			/// std::equal_to and std::hash is available, so only the duplicated
+			/// values are sorted
 			template<typename EqualToCompare = std::equal_to<value_type>>
 			FilteredRange duplicates( EqualToCompare comp = EqualToCompare( ) ) const {
-				auto result = copy_of_me( ).do_filter( ).sort( );
-				auto new_vals = std::vector<std::reference_wrapper<value_type>>( );
-				auto it = result.begin( );
-				while( it != result.end( ) ) {
-					auto cur_val = *it;
-					if( (it + 1) != result.end( ) && comp( cur_val, *(it + 1) ) ) {
-						new_vals.push_back( cur_val );
-					}
-					++it;						
-					while( it != result.end( ) && comp( cur_val, *it ) ) {
-						++it;
-					}
-				}
-				result.m_value_refs = new_vals;
+				DAW_RANGE_OPERATION( "duplicates", m_value_refs.get( ).size( ) );
+				auto result = duplicates_impl( comp, use_hash<EqualToCompare>( ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
@@ -322,32 +1029,226 @@ namespace daw {
 			/// repeats
 			template<typename EqualToCompare = std::equal_to<value_type>>
 			FilteredRange stable_duplicates( EqualToCompare comp = EqualToCompare( ) ) const {
-				auto valid_vals = duplicates( comp );
-				auto result = copy_of_me( )
-					.do_filter( )
-					.where( [&valid_vals]( const value_type& value ) { return valid_vals.contains( value ); } )
-					.stable_unique( )
-					.do_filter( ).clear_where( );
+				DAW_RANGE_OPERATION( "stable_duplicates", m_value_refs.get( ).size( ) );
+				auto result = stable_duplicates_impl( comp, use_hash<EqualToCompare>( ) );
+				DAW_RANGE_OPERATION_OUT( result.m_value_refs.get( ).size( ) );
 				return result;
 			}
 
 			//////////////////////////////////////////////////////////////////////////
-			/// Summary: Returns a boolean indicating if value is in the range
-			template<typename EqualToCompare = std::equal_to<value_type>>
-			bool contains( value_type value, EqualToCompare comp = EqualToCompare( ) ) const {
-				auto result = copy_of_me( ).do_filter( );
-				for( auto current_value : result.m_value_refs ) {
-					if( comp( value, current_value ) ) {
-						return true;
-					}
-				}
-				return false;
+			/// Summary: Returns each distinct value with the number of times it
+			/// occurs, in order of first occurrence
+			std::vector<std::pair<value_type, size_t>> frequencies( ) const {
+				return frequencies( std::hash<value_type>( ), std::equal_to<value_type>( ) );
 			}
 
 			//////////////////////////////////////////////////////////////////////////
-			/// Summary: Returns a boolean indicating if the range is empty
-			bool empty( ) const {
-				return m_value_refs.empty( );
+			/// Summary: Returns each distinct value with the number of times it
+			/// occurs, in order of first occurrence.  Values that are equal by comp
+			/// must have the same hash.
+			template<typename Hash, typename EqualToCompare>
+			std::vector<std::pair<value_type, size_t>> frequencies( Hash hash, EqualToCompare comp ) const {
+				auto counted = tally( hash, comp );
+				auto result = std::vector<std::pair<value_type, size_t>>( );
+				result.reserve( counted.first.size( ) );
+				for( size_t n = 0; n < counted.first.size( ); ++n ) {
+					result.emplace_back( deref( counted.first[n] ), counted.second[n] );
+				}
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns the number of values that repeat an earlier value,
+			/// i.e. how many stable_unique would remove
+			size_t count_duplicates( ) const {
+				return count_duplicates( std::hash<value_type>( ), std::equal_to<value_type>( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns the number of values that repeat an earlier value.
+			/// Values that are equal by comp must have the same hash.
+			template<typename Hash, typename EqualToCompare>
+			size_t count_duplicates( Hash hash, EqualToCompare comp ) const {
+				size_t result = 0;
+				for( auto count : tally( hash, comp ).second ) {
+					result += count - 1;
+				}
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if value is in the range
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			bool contains( const value_type& value, EqualToCompare comp = EqualToCompare( ) ) const {
+				if( m_use_lookup && std::is_same<EqualToCompare, std::equal_to<value_type>>::value ) {
+					return current_lookup( )->index->contains( value );
+				}
+				return find_if( [&value, &comp]( const value_type& current_value ) { return comp( value, current_value ); } ) != nullptr;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a copy of the range whose contains answers from a
+			/// lookup index instead of a scan.  The index is built on the first
+			/// call, hashed when std::hash is available and sorted otherwise, and
+			/// rebuilt after any operation changes which values are in the range
+			/// or writes to them with for_each, replace or replace_if, on this
+			/// range or any range derived from the same one.  Changes made to the
+			/// source directly, or through a range created from it separately, are
+			/// not seen by an index already built
+			FilteredRange with_lookup( ) const {
+				auto result = copy_of_me( );
+				result.m_use_lookup = true;
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a copy of the range that chooses the order of its
+			/// where predicates from measurements instead of the order they were
+			/// added.  Each pass over the values runs every predicate on the first
+			/// sample_size values, timing them and counting how many they reject,
+			/// then evaluates the cheapest and most selective first.  Long ranges
+			/// are measured again every recheck_interval values.  The predicates
+			/// must not depend on the order they are called in
+			FilteredRange with_adaptive_where( size_t sample_size = 512, size_t recheck_interval = 65536 ) const {
+				auto result = copy_of_me( );
+				result.m_adaptive = impl::adaptive_options( sample_size, recheck_interval );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a copy of the range whose buffers come from
+			/// resource, and so do those of every range derived from it.  With a
+			/// monotonic_arena a chain of operations allocates from a few large
+			/// blocks that are freed together.  resource must outlive the ranges
+			FilteredRange with_resource( memory_resource& resource ) const {
+				auto result = copy_of_me( );
+				auto const & values = m_value_refs.get( );
+				result.m_value_refs = impl::shared_vector<element_type, element_allocator>( element_vector( values.begin( ), values.end( ), element_allocator( &resource ) ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if every value in values is
+			/// in the range.  Builds one lookup index for all of them
+			template<typename Container>
+			bool contains_all( const Container& values ) const {
+				auto const cache = current_lookup( );
+				for( auto const & value : values ) {
+					if( !cache->index->contains( value ) ) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			bool contains_all( std::initializer_list<value_type> values ) const {
+				return contains_all<std::initializer_list<value_type>>( values );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if any value in values is in
+			/// the range.  Builds one lookup index for all of them
+			template<typename Container>
+			bool contains_any( const Container& values ) const {
+				auto const cache = current_lookup( );
+				for( auto const & value : values ) {
+					if( cache->index->contains( value ) ) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			bool contains_any( std::initializer_list<value_type> values ) const {
+				return contains_any<std::initializer_list<value_type>>( values );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if the range is empty
+			bool empty( ) const {
+				return each_included( []( value_type& ) { return false; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns the first value in the range.  Throws
+			/// std::out_of_range when the range is empty
+			value_type& first( ) const {
+				auto result = find_if( []( const value_type& ) { return true; } );
+				if( nullptr == result ) {
+					throw std::out_of_range( "first of an empty range" );
+				}
+				return *result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a pointer to the first value for which pred is
+			/// true, or nullptr.  Stops at the first match
+			template<typename UnaryPredicate>
+			value_type* find_if( UnaryPredicate pred ) const {
+				value_type* result = nullptr;
+				each_included( [&pred, &result]( value_type& value ) {
+					if( pred( value ) ) {
+						result = &value;
+						return false;
+					}
+					return true;
+				} );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if pred is true for any value.
+			/// Stops at the first match
+			template<typename UnaryPredicate>
+			bool any( UnaryPredicate pred ) const {
+				return nullptr != find_if( pred );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if pred is true for every
+			/// value.  Stops at the first mismatch
+			template<typename UnaryPredicate>
+			bool all( UnaryPredicate pred ) const {
+				return each_included( [&pred]( value_type& value ) { return static_cast<bool>(pred( value )); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if pred is false for every
+			/// value.  Stops at the first match
+			template<typename UnaryPredicate>
+			bool none( UnaryPredicate pred ) const {
+				return nullptr == find_if( pred );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of values in the range
+			size_t count( ) const {
+				size_t result = 0;
+				each_included( [&result]( value_type& ) {
+					++result;
+					return true;
+				} );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of values in the range for which pred is true
+			template<typename UnaryPredicate>
+			size_t count( UnaryPredicate pred ) const {
+				size_t result = 0;
+				each_included( [&pred, &result]( value_type& value ) {
+					if( pred( value ) ) {
+						++result;
+					}
+					return true;
+				} );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of values in the range
+			size_t size( ) const {
+				return count( );
 			}
 
 			//////////////////////////////////////////////////////////////////////////
@@ -359,49 +1260,330 @@ namespace daw {
 				return result;
 			}
 
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Folds the values in order with op( accumulator, value ),
+			/// starting from init.  The predicates are evaluated in the same pass
+			template<typename T, typename BinaryOp>
+			T reduce( T init, BinaryOp op ) const {
+				each_included( [&init, &op]( value_type& value ) {
+					init = op( std::move( init ), value );
+					return true;
+				} );
+				return init;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sum of the values.  Arithmetic values are added in
+			/// several independent accumulators, so floating point sums may round
+			/// differently than a sequential sum
+			value_type sum( ) const {
+				return sum_impl( std::is_arithmetic<value_type>( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Smallest value.  Throws std::out_of_range when the range is
+			/// empty
+			value_type min( ) const {
+				return minmax( ).first;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Largest value.  Throws std::out_of_range when the range is
+			/// empty
+			value_type max( ) const {
+				return minmax( ).second;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Smallest and largest value found in one pass.  Throws
+			/// std::out_of_range when the range is empty
+			std::pair<value_type, value_type> minmax( ) const {
+				return minmax_impl( std::is_arithmetic<value_type>( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Arithmetic mean of the values.  Throws std::out_of_range
+			/// when the range is empty
+			double mean( ) const {
+				static_assert(std::is_arithmetic<value_type>::value, "mean requires an arithmetic value_type");
+				auto const total = fold_lanes( 0.0, []( double acc, const value_type& value ) { return acc + static_cast<double>(value); }, []( double lhs, double rhs ) { return lhs + rhs; } );
+				if( 0 == total.second ) {
+					throw std::out_of_range( "mean of an empty range" );
+				}
+				return total.first / static_cast<double>(total.second);
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Groups the values by key_func( value ) for aggregation with
+			/// count, sum, min, max or fold on the result.  cardinality_hint, the
+			/// expected number of distinct keys, pre-sizes the hash table
+			template<typename KeyFunc>
+			GroupedRange<value_type, Storage, KeyFunc> group_by( KeyFunc key_func, size_t cardinality_hint = 0 ) const {
+				return GroupedRange<value_type, Storage, KeyFunc>( *this, std::move( key_func ), cardinality_hint );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a lazy view of the range.  Calls on the view are
+			/// recorded and only run by a terminal operation (to_vector, for_each,
+			/// copy_to, contains) so that adjacent where clauses fuse into a 
+			/// single pass without intermediate vectors.
+			LazyFilteredRange<value_type, impl::lazy_source<value_type, Storage>> lazy( ) const {
+				return LazyFilteredRange<value_type, impl::lazy_source<value_type, Storage>>( impl::lazy_source<value_type, Storage>( std::make_shared<FilteredRange>( *this ) ) );
+			}
+
 		private:
-			using iter_type = typename std::vector<std::reference_wrapper<value_type>>::iterator;
-			using citer_type = typename std::vector<std::reference_wrapper<value_type>>::const_iterator;
+			template<typename, typename> friend class LazyFilteredRange;
+			friend class SelectedRange<value_type>;
+			friend class FilteredRangeGroup<value_type, Storage>;
+			template<typename, typename, typename> friend class GroupedRange;
+			friend struct impl::lazy_source<value_type, Storage>;
+
+			using element_allocator = resource_allocator<element_type>;
+			using element_vector = std::vector<element_type, element_allocator>;
+			using iter_type = typename element_vector::iterator;
+			using citer_type = typename element_vector::const_iterator;
 
-			using predicate_ref_type = std::function < bool( std::reference_wrapper<value_type> ) > ;
+			using predicate_ref_type = std::function < bool( element_type ) > ;
 			using filtered_iterator = boost::filter_iterator < predicate_ref_type, iter_type > ;
 			using cfiltered_iterator = boost::filter_iterator < predicate_ref_type, citer_type >;
-			std::vector<std::reference_wrapper<value_type>> m_value_refs;
-			std::vector<predicate_type> m_pred_include;
+			Storage m_storage;
+			impl::shared_vector<element_type, element_allocator> m_value_refs;
+			impl::shared_vector<predicate_type> m_pred_include;
+			const void* m_sorted_by;	// The comparator the values were last sorted by, nullptr when unknown.  See is_sorted_by
+
+			// A lookup index and the state it was built from.  Holding the state
+			// keeps it shared, so any change to it detaches and the identities no
+			// longer match.  A write through any range sharing the storage moves
+			// the write count on
+			struct lookup_cache {
+				impl::shared_vector<element_type, element_allocator> value_refs;
+				impl::shared_vector<predicate_type> pred_include;
+				uint64_t writes;
+				std::unique_ptr<impl::value_lookup<value_type>> index;
+			};
+			mutable std::shared_ptr<const lookup_cache> m_lookup;
+			bool m_use_lookup;
+			impl::adaptive_options m_adaptive;
+
+			// The index for the current membership, building it if needed.  It is
+			// only kept when with_lookup was used
+			std::shared_ptr<const lookup_cache> current_lookup( ) const {
+				auto cache = std::atomic_load( &m_lookup );
+				if( cache && cache->value_refs.shares_with( m_value_refs ) && cache->pred_include.shares_with( m_pred_include ) && cache->writes == m_storage.write_count( ) ) {
+					return cache;
+				}
+				auto filtered = copy_of_me( ).do_filter( );
+				auto fresh = std::make_shared<lookup_cache>( );
+				fresh->value_refs = m_value_refs;
+				fresh->pred_include = m_pred_include;
+				fresh->writes = m_storage.write_count( );
+				fresh->index = impl::make_lookup<value_type>( m_storage, filtered.m_value_refs.get( ) );
+				cache = fresh;
+				if( m_use_lookup ) {
+					std::atomic_store( &m_lookup, cache );
+				}
+				return cache;
+			}
 
+			value_type& deref( const element_type& element ) const {
+				return m_storage.deref( element );
+			}
+
+			// Adapts a comparison or predicate on values to one on elements
+			template<typename Func>
+			impl::deref_func<Storage, Func> by_value( Func func ) const {
+				return impl::deref_func<Storage, Func>( m_storage, std::move( func ) );
+			}
+
+			// Mutable access detaches m_value_refs from any ranges sharing it
 			iter_type begin( ) {
-				return m_value_refs.begin( );
+				return m_value_refs.mut( ).begin( );
 			}
 
 			iter_type end( ) {
-				return m_value_refs.end( );
+				return m_value_refs.mut( ).end( );
 			}
 
-			citer_type cbegin( ) {
-				return m_value_refs.cbegin( );
+			citer_type cbegin( ) const {
+				return m_value_refs.get( ).cbegin( );
 			}
 
-			citer_type cend( ) {
-				return m_value_refs.cend( );
+			citer_type cend( ) const {
+				return m_value_refs.get( ).cend( );
 			}
 
 			FilteredRange copy_of_me( ) const {
 				return FilteredRange( *this );
 			}
 
+			// The number of values to reserve room for.  Exact unless there are
+			// predicates, which are not run just to find out
+			size_t size_hint( ) const {
+				return m_pred_include.get( ).empty( ) ? m_value_refs.get( ).size( ) : 0;
+			}
+
+			// An empty buffer for elements from the same memory resource as the range
+			element_vector new_elements( ) const {
+				return element_vector( m_value_refs.get_allocator( ) );
+			}
+
 			FilteredRange& do_filter( ) {
-				if( !m_pred_include.empty( ) ) {
-					auto new_last = std::remove_if( begin( ), end( ), [&]( const value_type& value ) { return !value_included( value ); } );
-					m_value_refs.erase( new_last, end( ) );
+				if( m_pred_include.get( ).empty( ) ) {
+					return *this;
 				}
+				DAW_RANGE_OPERATION( "filter", m_value_refs.get( ).size( ) );
+				if( is_adaptive( ) ) {
+					auto survivors = new_elements( );
+					impl::adaptive_filter( m_pred_include.get( ), m_value_refs.get( ), m_storage, m_adaptive, [&survivors]( const element_type& element ) {
+						survivors.push_back( element );
+						return true;
+					} );
+					m_value_refs = impl::shared_vector<element_type, element_allocator>( std::move( survivors ) );
+				} else if( m_value_refs.is_unique( ) ) {
+					auto new_last = std::remove_if( begin( ), end( ), [&]( const element_type& value ) { return !value_included( deref( value ) ); } );
+					m_value_refs.mut( ).erase( new_last, end( ) );
+				} else {
+					// Shared, so build the survivors directly instead of copying everything first
+					auto survivors = new_elements( );
+					for( auto& current_value : m_value_refs.get( ) ) {
+						if( value_included( deref( current_value ) ) ) {
+							survivors.push_back( current_value );
+						}
+					}
+					m_value_refs = impl::shared_vector<element_type, element_allocator>( std::move( survivors ) );
+				}
+				DAW_RANGE_OPERATION_OUT( m_value_refs.get( ).size( ) );
 				return *this;
 			}
 
-			bool value_included( const value_type& value ) const {
-				if( m_pred_include.empty( ) ) {
+			FilteredRange& do_filter( const execution::policy& policy ) {
+				if( m_pred_include.get( ).empty( ) ) {
+					return *this;
+				}
+				DAW_RANGE_OPERATION( "filter", m_value_refs.get( ).size( ) );
+				m_value_refs = impl::shared_vector<element_type, element_allocator>( impl::parallel_copy_if( policy, m_value_refs.get( ), [this]( const element_type& value ) { return value_included( deref( value ) ); } ) );
+				DAW_RANGE_OPERATION_OUT( m_value_refs.get( ).size( ) );
+				return *this;
+			}
+
+			// Calls func( value ) on each included value in order, evaluating the
+			// predicates as it goes.  Stops and returns false when func returns false
+			template<typename Func>
+			bool each_included( Func func ) const {
+#ifdef DAW_RANGE_INSTRUMENT
+				DAW_RANGE_OPERATION( "scan", m_value_refs.get( ).size( ) );
+				size_t passed = 0;
+				auto const result = scan( [&passed, &func]( value_type& value ) {
+					++passed;
+					return static_cast<bool>(func( value ));
+				} );
+				DAW_RANGE_OPERATION_OUT( passed );
+				return result;
+#else
+				return scan( std::move( func ) );
+#endif
+			}
+
+			template<typename Func>
+			bool scan( Func func ) const {
+				if( is_adaptive( ) ) {
+					auto const & storage = m_storage;
+					return impl::adaptive_filter( m_pred_include.get( ), m_value_refs.get( ), m_storage, m_adaptive, [&storage, &func]( const element_type& element ) { return func( storage.deref( element ) ); } );
+				}
+				for( auto& current_value : m_value_refs.get( ) ) {
+					auto& value = deref( current_value );
+					if( value_included( value ) && !func( value ) ) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// Folds the included values into independent accumulators, one per
+			// lane, so consecutive additions or comparisons do not wait on each
+			// other.  With no predicates the loop is unrolled by the lane count.
+			// Returns the combined result and the number of values folded
+			template<typename T, typename Fold, typename Combine>
+			std::pair<T, size_t> fold_lanes( T identity, Fold fold, Combine combine ) const {
+				static const size_t lanes = 4;
+				T acc[lanes] = { identity, identity, identity, identity };
+				auto const & values = m_value_refs.get( );
+				size_t count = 0;
+				if( m_pred_include.get( ).empty( ) ) {
+					size_t n = 0;
+					for( ; n + lanes <= values.size( ); n += lanes ) {
+						acc[0] = fold( acc[0], deref( values[n] ) );
+						acc[1] = fold( acc[1], deref( values[n + 1] ) );
+						acc[2] = fold( acc[2], deref( values[n + 2] ) );
+						acc[3] = fold( acc[3], deref( values[n + 3] ) );
+					}
+					for( ; n < values.size( ); ++n ) {
+						acc[n % lanes] = fold( acc[n % lanes], deref( values[n] ) );
+					}
+					count = values.size( );
+				} else {
+					each_included( [&]( const value_type& value ) {
+						acc[count % lanes] = fold( acc[count % lanes], value );
+						++count;
+						return true;
+					} );
+				}
+				return std::make_pair( combine( combine( acc[0], acc[1] ), combine( acc[2], acc[3] ) ), count );
+			}
+
+			value_type sum_impl( std::true_type ) const {
+				auto add = []( value_type lhs, value_type rhs ) { return static_cast<value_type>(lhs + rhs); };
+				return fold_lanes( value_type( 0 ), add, add ).first;
+			}
+
+			value_type sum_impl( std::false_type ) const {
+				return reduce( value_type( ), []( value_type acc, const value_type& value ) { return acc + value; } );
+			}
+
+			std::pair<value_type, value_type> minmax_impl( std::true_type ) const {
+				using bounds = std::pair<value_type, value_type>;
+				// Infinities are the identities when there are any, so a range of
+				// only +inf has a min of +inf rather than max( )
+				using limits = std::numeric_limits<value_type>;
+				auto const identity = bounds( limits::has_infinity ? limits::infinity( ) : limits::max( ), limits::has_infinity ? static_cast<value_type>(-limits::infinity( )) : limits::lowest( ) );
+				auto const result = fold_lanes( identity, []( const bounds& acc, const value_type& value ) {
+					return bounds( value < acc.first ? value : acc.first, acc.second < value ? value : acc.second );
+				}, []( const bounds& lhs, const bounds& rhs ) {
+					return bounds( rhs.first < lhs.first ? rhs.first : lhs.first, lhs.second < rhs.second ? rhs.second : lhs.second );
+				} );
+				if( 0 == result.second ) {
+					throw std::out_of_range( "minmax of an empty range" );
+				}
+				return result.first;
+			}
+
+			std::pair<value_type, value_type> minmax_impl( std::false_type ) const {
+				const value_type* smallest = nullptr;
+				const value_type* largest = nullptr;
+				each_included( [&smallest, &largest]( value_type& value ) {
+					if( nullptr == smallest || value < *smallest ) {
+						smallest = &value;
+					}
+					if( nullptr == largest || *largest < value ) {
+						largest = &value;
+					}
 					return true;
+				} );
+				if( nullptr == smallest ) {
+					throw std::out_of_range( "minmax of an empty range" );
 				}
-				for( auto& included : m_pred_include ) {
+				return std::make_pair( *smallest, *largest );
+			}
+
+			// Reordering only pays off with more than one predicate
+			bool is_adaptive( ) const {
+				return m_adaptive.enabled( ) && m_pred_include.get( ).size( ) > 1;
+			}
+
+			bool value_included( const value_type& value ) const {
+				auto const & predicates = m_pred_include.get( );
+				for( auto& included : predicates ) {
+					DAW_RANGE_PREDICATE_CALL( static_cast<size_t>(&included - predicates.data( )) );
 					if( !included( value ) ) {
 						return false;
 					}
@@ -409,8 +1591,162 @@ namespace daw {
 				return true;
 			}
 
-			template<typename EqualToCompare = std::equal_to<value_type>>
-			static iter_type find( iter_type first_inclusive, iter_type last_exclusive, std::reference_wrapper<value_type> val, EqualToCompare comp ) {
+			// True when comp is plain equality and value_type can be hashed
+			template<typename EqualToCompare>
+			using use_hash = std::integral_constant<bool, impl::is_hashable<value_type>::value && std::is_same<EqualToCompare, std::equal_to<value_type>>::value>;
+
+			// The distinct included elements in order of first occurrence and how often each occurs
+			template<typename Hash, typename EqualToCompare>
+			std::pair<element_vector, std::vector<size_t>> tally( Hash hash, EqualToCompare comp ) const {
+				auto const & values = m_value_refs.get( );
+				auto table = impl::open_hash_table<element_type, impl::deref_func<Storage, Hash>, impl::deref_func<Storage, EqualToCompare>, element_allocator>( values.size( ), by_value( hash ), by_value( comp ), m_value_refs.get_allocator( ) );
+				auto counts = std::vector<size_t>( );
+				for( auto& current_value : values ) {
+					if( value_included( deref( current_value ) ) ) {
+						auto const pos = table.find_or_insert( current_value );
+						if( pos.second ) {
+							counts.push_back( 1 );
+						} else {
+							++counts[pos.first];
+						}
+					}
+				}
+				return std::make_pair( table.release_keys( ), std::move( counts ) );
+			}
+
+			template<typename EqualToCompare>
+			FilteredRange duplicates_impl( EqualToCompare comp, std::true_type ) const {
+				auto counted = tally( std::hash<value_type>( ), comp );
+				auto new_vals = new_elements( );
+				for( size_t n = 0; n < counted.first.size( ); ++n ) {
+					if( counted.second[n] > 1 ) {
+						new_vals.push_back( counted.first[n] );
+					}
+				}
+				std::sort( new_vals.begin( ), new_vals.end( ), by_value( std::less<value_type>( ) ) );
+				auto result = FilteredRange( std::move( new_vals ), m_pred_include, m_storage );
+				result.template mark_sorted<std::less<value_type>>( );
+				return result;
+			}
+
+			template<typename EqualToCompare>
+			FilteredRange duplicates_impl( EqualToCompare comp, std::false_type ) const {
+				auto result = copy_of_me( ).do_filter( ).sort( );
+				auto new_vals = new_elements( );
+				auto it = result.begin( );
+				auto value_comp = result.by_value( comp );
+				while( it != result.end( ) ) {
+					auto cur_val = *it;
+					if( (it + 1) != result.end( ) && value_comp( cur_val, *(it + 1) ) ) {
+						new_vals.push_back( cur_val );
+					}
+					++it;						
+					while( it != result.end( ) && value_comp( cur_val, *it ) ) {
+						++it;
+					}
+				}
+				result.m_value_refs = impl::shared_vector<element_type, element_allocator>( std::move( new_vals ) );
+				return result;
+			}
+
+
+			template<typename EqualToCompare>
+			FilteredRange stable_duplicates_impl( EqualToCompare comp, std::true_type ) const {
+				auto counted = tally( std::hash<value_type>( ), comp );
+				auto new_vals = new_elements( );
+				for( size_t n = 0; n < counted.first.size( ); ++n ) {
+					if( counted.second[n] > 1 ) {
+						new_vals.push_back( counted.first[n] );
+					}
+				}
+				return FilteredRange( std::move( new_vals ), { }, m_storage );
+			}
+
+			template<typename EqualToCompare>
+			FilteredRange stable_duplicates_impl( EqualToCompare comp, std::false_type ) const {
+				auto valid_vals = duplicates( comp );
+				auto result = copy_of_me( )
+					.do_filter( )
+					.where( [&valid_vals]( const value_type& value ) { return valid_vals.contains( value ); } )
+					.stable_unique( )
+					.do_filter( ).clear_where( );
+				return result;
+			}
+
+			template<typename EqualToCompare>
+			FilteredRange stable_unique_impl( EqualToCompare comp, std::true_type ) const {
+				return stable_unique( std::hash<value_type>( ), comp );
+			}
+
+			// No hash for value_type, so fall back to searching the kept values
+			template<typename EqualToCompare>
+			FilteredRange stable_unique_impl( EqualToCompare comp, std::false_type ) const {
+				auto result = new_elements( );
+				for( auto& current_value : m_value_refs.get( ) ) {
+					if( value_included( deref( current_value ) ) && result.end( ) == find( result.begin( ), result.end( ), current_value, by_value( comp ) ) ) {
+						result.push_back( current_value );
+					}
+				}
+				return FilteredRange( std::move( result ), m_pred_include, m_storage );
+			}
+
+			// Sortedness is only tracked for stateless comparators, where every
+			// object of the type orders values the same way
+			template<typename LessThanCompare>
+			static const void* sort_key( ) {
+				return std::is_empty<LessThanCompare>::value ? impl::type_key<LessThanCompare>( ) : nullptr;
+			}
+
+			// The mark is only a hint.  The values are references into data that
+			// can be changed through another range or the source, so a marked
+			// range is checked in O(n) before a sort is skipped
+			template<typename LessThanCompare>
+			bool is_sorted_by( const LessThanCompare& comp ) const {
+				if( nullptr == m_sorted_by || sort_key<LessThanCompare>( ) != m_sorted_by ) {
+					return false;
+				}
+				auto const & values = m_value_refs.get( );
+				return std::is_sorted( values.begin( ), values.end( ), by_value( comp ) );
+			}
+
+			template<typename LessThanCompare>
+			void mark_sorted( ) {
+				m_sorted_by = sort_key<LessThanCompare>( );
+			}
+
+			// Filters and sorts by comp unless the values are already known or
+			// found to be in order
+			template<typename LessThanCompare>
+			FilteredRange sorted_by( LessThanCompare comp ) const {
+				auto result = copy_of_me( ).do_filter( );
+				if( !result.is_sorted_by( comp ) ) {
+					auto const & values = result.m_value_refs.get( );
+					if( !std::is_sorted( values.begin( ), values.end( ), by_value( comp ) ) && !impl::radix_sort<value_type>( result.m_value_refs.mut( ), m_storage, comp ) ) {
+						std::sort( result.begin( ), result.end( ), by_value( comp ) );
+					}
+					result.template mark_sorted<LessThanCompare>( );
+				}
+				return result;
+			}
+
+			// Runs merge( lhs, rhs, out, comp ) on the sorted elements of both ranges
+			template<typename LessThanCompare, typename Merge>
+			FilteredRange merge_sorted( const FilteredRange& other, LessThanCompare comp, Merge merge ) const {
+				if( !m_storage.same_source( other.m_storage ) ) {
+					throw std::invalid_argument( "Set operations require ranges over the same source" );
+				}
+				auto const lhs = sorted_by( comp );
+				auto const rhs = other.sorted_by( comp );
+				auto out = new_elements( );
+				out.reserve( lhs.m_value_refs.get( ).size( ) + rhs.m_value_refs.get( ).size( ) );
+				merge( lhs.m_value_refs.get( ), rhs.m_value_refs.get( ), out, by_value( comp ) );
+				auto result = FilteredRange( std::move( out ), { }, m_storage );
+				result.template mark_sorted<LessThanCompare>( );
+				return result;
+			}
+
+			template<typename EqualToCompare>
+			static iter_type find( iter_type first_inclusive, iter_type last_exclusive, const element_type& val, EqualToCompare comp ) {
 				auto result = last_exclusive;
 				for( auto it = first_inclusive; it != last_exclusive; ++it ) {
 					if( comp( val, *it ) ) {
@@ -421,17 +1757,279 @@ namespace daw {
 				return result;
 			}
 
-			FilteredRange( const std::vector<std::reference_wrapper<value_type>>& value_refs, std::vector<predicate_type> predicate_stack ): m_value_refs( value_refs ), m_pred_include( predicate_stack ) { }
+			FilteredRange( element_vector value_refs, impl::shared_vector<predicate_type> predicate_stack, Storage storage = Storage( ) ): m_storage( std::move( storage ) ), m_value_refs( std::move( value_refs ) ), m_pred_include( std::move( predicate_stack ) ), m_sorted_by( nullptr ), m_lookup( ), m_use_lookup( false ), m_adaptive( ) { }
 
-			std::pair<filtered_iterator, filtered_iterator> get_filtered_iterators( ) {
-				auto pred = [&]( std::reference_wrapper<value_type> value ) { return value_included( value.get( ) ); };
+			std::pair<cfiltered_iterator, cfiltered_iterator> get_filtered_iterators( ) const {
+				auto pred = [&]( const element_type& value ) { return value_included( deref( value ) ); };
 
-				auto filtered_begin = filtered_iterator( pred, begin( ), end( ) );
-				auto filtered_end = filtered_iterator( pred, end( ), end( ) );
+				auto filtered_begin = cfiltered_iterator( pred, cbegin( ), cend( ) );
+				auto filtered_end = cfiltered_iterator( pred, cend( ), cend( ) );
 				return std::make_pair( filtered_begin, filtered_end );
 			}
 
 		};	// class FilteredRange
+
+		namespace impl {
+			// Each lazy stage exposes run( sink ) which pushes the surviving references
+			// in order to sink.  When sink returns false the traversal stops early and
+			// run returns false.
+			template<typename value_type, typename Storage>
+			struct lazy_source {
+				using ref_type = std::reference_wrapper<value_type>;
+				std::shared_ptr<const FilteredRange<value_type, Storage>> range;
+
+				explicit lazy_source( std::shared_ptr<const FilteredRange<value_type, Storage>> rng ): range( std::move( rng ) ) { }
+
+				template<typename Sink>
+				bool run( Sink& sink ) const {
+					for( auto& current_value : range->m_value_refs.get( ) ) {
+						auto& value = range->deref( current_value );
+						if( range->value_included( value ) && !sink( ref_type( value ) ) ) {
+							return false;
+						}
+					}
+					return true;
+				}
+			};
+
+			template<typename Prev, typename Predicate>
+			struct lazy_where {
+				Prev prev;
+				Predicate pred;
+
+				lazy_where( Prev p, Predicate predicate ): prev( std::move( p ) ), pred( std::move( predicate ) ) { }
+
+				template<typename Sink>
+				bool run( Sink& sink ) const {
+					auto filtered_sink = [&]( const typename Prev::ref_type& value ) {
+						return !pred( value.get( ) ) || sink( value );
+					};
+					return prev.run( filtered_sink );
+				}
+
+				using ref_type = typename Prev::ref_type;
+			};
+
+			// A stage that needs every element before it can emit any, e.g. sort.
+			// The upstream stages are collected into one vector that Op rearranges in place
+			template<typename Prev, typename Op>
+			struct lazy_reorder {
+				Prev prev;
+				Op op;
+
+				lazy_reorder( Prev p, Op operation ): prev( std::move( p ) ), op( std::move( operation ) ) { }
+
+				template<typename Sink>
+				bool run( Sink& sink ) const {
+					auto values = std::vector<ref_type>( );
+					auto collect = [&values]( const ref_type& value ) {
+						values.push_back( value );
+						return true;
+					};
+					prev.run( collect );
+					op( values );
+					for( auto& current_value : values ) {
+						if( !sink( current_value ) ) {
+							return false;
+						}
+					}
+					return true;
+				}
+
+				using ref_type = typename Prev::ref_type;
+			};
+
+			template<typename Compare>
+			struct lazy_sort_op {
+				Compare comp;
+				template<typename Container>
+				void operator()( Container& values ) const {
+					std::sort( values.begin( ), values.end( ), comp );
+				}
+			};
+
+			template<typename Compare>
+			struct lazy_stable_sort_op {
+				Compare comp;
+				template<typename Container>
+				void operator()( Container& values ) const {
+					std::stable_sort( values.begin( ), values.end( ), comp );
+				}
+			};
+
+			template<typename Compare>
+			struct lazy_unique_op {
+				Compare comp;
+				template<typename Container>
+				void operator()( Container& values ) const {
+					values.erase( std::unique( values.begin( ), values.end( ), comp ), values.end( ) );
+				}
+			};
+
+			struct lazy_reverse_op {
+				template<typename Container>
+				void operator()( Container& values ) const {
+					std::reverse( values.begin( ), values.end( ) );
+				}
+			};
+
+			template<typename UnaryPredicate>
+			struct lazy_partition_op {
+				UnaryPredicate pred;
+				template<typename Container>
+				void operator()( Container& values ) const {
+					std::partition( values.begin( ), values.end( ), pred );
+				}
+			};
+
+			template<typename UnaryPredicate>
+			struct lazy_stable_partition_op {
+				UnaryPredicate pred;
+				template<typename Container>
+				void operator()( Container& values ) const {
+					std::stable_partition( values.begin( ), values.end( ), pred );
+				}
+			};
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: A lazily evaluated view over a FilteredRange.  Each call 
+		/// returns a new view whose type records the pipeline.  Nothing is 
+		/// evaluated until a terminal operation runs.
+		template<typename value_type, typename Stage>
+		class LazyFilteredRange {
+		public:
+			explicit LazyFilteredRange( Stage stage ): m_stage( std::move( stage ) ) { }
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Adds a predicate that when false for a value 
+			/// filters out the value.  Fuses with the neighbouring where clauses
+			template<typename Predicate>
+			LazyFilteredRange<value_type, impl::lazy_where<Stage, Predicate>> where( Predicate pred ) const {
+				return make_view( impl::lazy_where<Stage, Predicate>( m_stage, std::move( pred ) ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sort the elements into ascending order.  See FilteredRange::sort
+			template<typename LessThanCompare = std::less<value_type>>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_sort_op<LessThanCompare>>> sort( LessThanCompare comp = LessThanCompare( ) ) const {
+				return reorder( impl::lazy_sort_op<LessThanCompare>{ comp } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sort the elements into ascending order preserving the 
+			/// relative order of equivalent values.  See FilteredRange::stable_sort
+			template<typename LessThanCompare = std::less<value_type>>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_stable_sort_op<LessThanCompare>>> stable_sort( LessThanCompare comp = LessThanCompare( ) ) const {
+				return reorder( impl::lazy_stable_sort_op<LessThanCompare>{ comp } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Removes all consecutive duplicate elements
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_unique_op<EqualToCompare>>> unique( EqualToCompare comp = EqualToCompare( ) ) const {
+				return reorder( impl::lazy_unique_op<EqualToCompare>{ comp } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Reverses the order of the elements
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_reverse_op>> reverse( ) const {
+				return reorder( impl::lazy_reverse_op{ } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Moves the elements for which pred is true before those
+			/// for which it is false.  See FilteredRange::partition
+			template<typename UnaryPredicate>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_partition_op<UnaryPredicate>>> partition( UnaryPredicate pred ) const {
+				return reorder( impl::lazy_partition_op<UnaryPredicate>{ pred } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Moves the elements for which pred is true before those
+			/// for which it is false preserving the relative order within each group
+			template<typename UnaryPredicate>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, impl::lazy_stable_partition_op<UnaryPredicate>>> stable_partition( UnaryPredicate pred ) const {
+				return reorder( impl::lazy_stable_partition_op<UnaryPredicate>{ pred } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  On every valid element do something
+			template<typename Func>
+			LazyFilteredRange for_each( Func func ) const {
+				auto sink = [&func]( const std::reference_wrapper<value_type>& value ) {
+					func( value.get( ) );
+					return true;
+				};
+				m_stage.run( sink );
+				return *this;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Copy all valid values to a std::vector
+			std::vector<value_type> to_vector( ) const {
+				auto result = std::vector<value_type>( );
+				auto sink = [&result]( const std::reference_wrapper<value_type>& value ) {
+					result.push_back( value.get( ) );
+					return true;
+				};
+				m_stage.run( sink );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Copy all valid values to the provided range up 
+			/// to the smallest list.
+			template<typename Iter>
+			LazyFilteredRange copy_to( Iter first_inclusive, Iter last_exclusive ) const {
+				auto out_it = first_inclusive;
+				auto sink = [&out_it, &last_exclusive]( const std::reference_wrapper<value_type>& value ) {
+					if( out_it == last_exclusive ) {
+						return false;
+					}
+					*out_it++ = value.get( );
+					return true;
+				};
+				m_stage.run( sink );
+				return *this;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Returns a boolean indicating if value is in the
+			/// range.  Stops at the first match
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			bool contains( const value_type& value, EqualToCompare comp = EqualToCompare( ) ) const {
+				auto sink = [&value, &comp]( const std::reference_wrapper<value_type>& current_value ) {
+					return !comp( value, current_value.get( ) );
+				};
+				return !m_stage.run( sink );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Evaluates the pipeline into an eager FilteredRange
+			FilteredRange<value_type> to_filtered_range( ) const {
+				auto values = typename FilteredRange<value_type>::element_vector( );
+				auto sink = [&values]( const std::reference_wrapper<value_type>& value ) {
+					values.push_back( value );
+					return true;
+				};
+				m_stage.run( sink );
+				return FilteredRange<value_type>( std::move( values ), { } );
+			}
+
+		private:
+			Stage m_stage;
+
+			template<typename NewStage>
+			static LazyFilteredRange<value_type, NewStage> make_view( NewStage stage ) {
+				return LazyFilteredRange<value_type, NewStage>( std::move( stage ) );
+			}
+
+			template<typename Op>
+			LazyFilteredRange<value_type, impl::lazy_reorder<Stage, Op>> reorder( Op op ) const {
+				return make_view( impl::lazy_reorder<Stage, Op>( m_stage, std::move( op ) ) );
+			}
+		};	// class LazyFilteredRange
 		
 		
 		template<typename Container>
@@ -439,5 +2037,18 @@ namespace daw {
 			return FilteredRange<typename std::iterator_traits<decltype(std::begin( container ))>::value_type>( std::begin( container ), std::end( container ) );
 		}
 
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Creates a FilteredRange over a random access container that
+		/// stores an Index per value instead of a reference.  Only values from
+		/// container can be appended to the result
+		template<typename Index = uint32_t, typename Container>
+		auto create_indexed_range( Container& container ) -> FilteredRange < typename std::iterator_traits<decltype(std::begin( container ))>::value_type, impl::index_storage<typename std::iterator_traits<decltype(std::begin( container ))>::value_type, decltype(std::begin( container )), Index> > {
+			using iter_t = decltype(std::begin( container ));
+			using value_t = typename std::iterator_traits<iter_t>::value_type;
+			static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<iter_t>::iterator_category>::value, "create_indexed_range requires a random access container");
+			static_assert(std::is_unsigned<Index>::value, "Index must be an unsigned integral type");
+			return FilteredRange<value_t, impl::index_storage<value_t, iter_t, Index>>( std::begin( container ), std::end( container ) );
+		}
+
 	}	// namespace range	
 }	// namespace daw
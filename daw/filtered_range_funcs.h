@@ -1,185 +1,429 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "filtered_range_hash.h"
 
 namespace daw {
 	namespace range {
-		// Where clauses
+		namespace impl {
+			// Concrete predicate objects.  Unlike std::function these can be inlined
+			// and the operators below use their types to simplify combinations,
+			// e.g. a greater and a less become one range check and ORed equality 
+			// tests become one membership test.
+			struct predicate_tag { };
 
-		template<typename value_type, typename BinaryComp = std::less<value_type>>
-		std::function <bool( value_type )> is_less( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
-			};
-		}
+			template<typename T>
+			using is_predicate = std::is_base_of<predicate_tag, typename std::decay<T>::type>;
 
-		template<typename value_type, typename BinaryComp = std::less_equal<value_type>>
-		std::function <bool( value_type )> is_less_or_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
+			template<typename value_type, typename BinaryComp>
+			struct compare_to: predicate_tag {
+				value_type value;
+				BinaryComp comp;
+
+				compare_to( value_type val, BinaryComp binary_comp ): value( std::move( val ) ), comp( std::move( binary_comp ) ) { }
+
+				bool operator()( const value_type& test_val ) const {
+					return comp( test_val, value );
+				}
 			};
-		}
 
-		template<typename value_type, typename BinaryComp = std::greater<value_type>>
-		std::function <bool( value_type )> is_greater( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
+			template<typename Lhs, typename Rhs>
+			struct and_pred: predicate_tag {
+				Lhs lhs;
+				Rhs rhs;
+
+				and_pred( Lhs l, Rhs r ): lhs( std::move( l ) ), rhs( std::move( r ) ) { }
+
+				template<typename T>
+				bool operator()( const T& test_val ) const {
+					return lhs( test_val ) && rhs( test_val );
+				}
 			};
-		}
 
-		template<typename value_type, typename BinaryComp = std::greater_equal<value_type>>
-		std::function <bool( value_type )> is_greater_or_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
+			template<typename Lhs, typename Rhs>
+			struct or_pred: predicate_tag {
+				Lhs lhs;
+				Rhs rhs;
+
+				or_pred( Lhs l, Rhs r ): lhs( std::move( l ) ), rhs( std::move( r ) ) { }
+
+				template<typename T>
+				bool operator()( const T& test_val ) const {
+					return lhs( test_val ) || rhs( test_val );
+				}
 			};
-		}
 
-		template<typename value_type, typename BinaryComp = std::equal_to<value_type>>
-		std::function <bool( value_type )> is_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
+			template<typename Pred>
+			struct not_pred: predicate_tag {
+				Pred pred;
+
+				explicit not_pred( Pred p ): pred( std::move( p ) ) { }
+
+				template<typename T>
+				bool operator()( const T& test_val ) const {
+					return !pred( test_val );
+				}
 			};
-		}
 
-		template<typename value_type, typename BinaryComp = std::not_equal_to<value_type>>
-		std::function <bool( value_type )> is_not_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
-			return[value, comp]( const value_type& test_val ) {
-				return comp( test_val, value );
+			template<typename value_type>
+			struct even_pred: predicate_tag {
+				bool operator()( const value_type& test_val ) const {
+					return 0 == test_val % 2;
+				}
 			};
-		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> logic_or( std::function <bool( value_type )> lhs, std::function <bool( value_type )> rhs ) {
-			return[lhs, rhs]( const value_type& test_val ) {
-				return lhs( test_val ) || rhs( test_val );
+			template<typename value_type>
+			struct odd_pred: predicate_tag {
+				bool operator()( const value_type& test_val ) const {
+					return 0 != test_val % 2;
+				}
 			};
-		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> logic_and( std::function <bool( value_type )> lhs, std::function <bool( value_type )> rhs ) {
-			return[lhs, rhs]( const value_type& test_val ) {
-				return lhs( test_val ) && rhs( test_val );
+			// Range check for lo (<|<=) value (<|<=) hi.  Integral types are normalized
+			// to inclusive bounds so that the test is a single unsigned comparison
+			template<typename T>
+			using is_bitwise_integral = std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>;
+
+			template<typename value_type, bool LoInclusive, bool HiInclusive, bool = is_bitwise_integral<value_type>::value>
+			struct in_range: predicate_tag {
+				value_type lo;
+				value_type hi;
+
+				in_range( value_type low, value_type high ): lo( std::move( low ) ), hi( std::move( high ) ) { }
+
+				bool operator()( const value_type& test_val ) const {
+					// The same comparisons as the unfused predicates, so that values
+					// such as NaN that are unordered fail both ways
+					return (LoInclusive ? test_val >= lo : test_val > lo) && (HiInclusive ? test_val <= hi : test_val < hi);
+				}
 			};
-		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> any_of( std::initializer_list<std::function<bool( value_type )>> preds ) {
-			return[preds]( const value_type& test_value ) {
-				foreach( auto& pred: preds ) {
-					if( pred( test_value ) ) {
-						return true;
+			template<typename value_type, bool LoInclusive, bool HiInclusive>
+			struct in_range<value_type, LoInclusive, HiInclusive, true>: predicate_tag {
+				using unsigned_type = typename std::make_unsigned<value_type>::type;
+				unsigned_type first;
+				unsigned_type span;
+				bool is_empty;
+
+				in_range( value_type low, value_type high ): first( ), span( ), is_empty( false ) {
+					if( (!LoInclusive && low == std::numeric_limits<value_type>::max( )) || (!HiInclusive && high == std::numeric_limits<value_type>::min( )) ) {
+						is_empty = true;
+						return;
 					}
+					auto const lo_bound = LoInclusive ? low : static_cast<value_type>(low + 1);
+					auto const hi_bound = HiInclusive ? high : static_cast<value_type>(high - 1);
+					is_empty = hi_bound < lo_bound;
+					first = static_cast<unsigned_type>(lo_bound);
+					span = static_cast<unsigned_type>(static_cast<unsigned_type>(hi_bound) - first);
+				}
+
+				bool operator()( const value_type& test_val ) const {
+					return !is_empty && static_cast<unsigned_type>(static_cast<unsigned_type>(test_val) - first) <= span;
 				}
-				return false;
 			};
-		}
 
-		namespace impl {
-			template<typename value_type, typename Func, typename ...Funcs>
-			bool is_none_of_impl( value_type value, Func func, Funcs... funcs ) {
-				if( !func( value ) ) {
-					return is_none_of_impl( value, funcs... );
+			// Membership test for an OR of equality tests.  Small integral spans use a
+			// bitmap, otherwise the values are kept sorted for a binary search.
+			template<typename value_type>
+			struct one_of: predicate_tag {
+				static const size_t max_bitmap_bits = 1 << 16;
+				std::vector<value_type> values;
+				std::vector<uint64_t> bitmap;
+
+				explicit one_of( std::vector<value_type> vals ): values( std::move( vals ) ), bitmap( ) {
+					sort_values( is_less_comparable<value_type>( ) );
+					build_bitmap( is_bitwise_integral<value_type>( ) );
 				}
-				return false;
+
+				bool operator()( const value_type& test_val ) const {
+					return contains( test_val, is_bitwise_integral<value_type>( ) );
+				}
+
+				one_of merge( const one_of& other ) const {
+					auto vals = values;
+					vals.insert( vals.end( ), other.values.begin( ), other.values.end( ) );
+					return one_of( std::move( vals ) );
+				}
+
+			private:
+				void sort_values( std::true_type ) {
+					std::sort( values.begin( ), values.end( ) );
+					values.erase( std::unique( values.begin( ), values.end( ) ), values.end( ) );
+				}
+
+				void sort_values( std::false_type ) { }
+
+				void build_bitmap( std::true_type ) {
+					// Compared before adding one, which wraps when the values span a
+					// whole 64-bit type
+					if( values.empty( ) || offset( values.back( ) ) >= max_bitmap_bits ) {
+						return;
+					}
+					bitmap.resize( bitmap_bits( ) / 64 + 1 );
+					for( auto const & value : values ) {
+						auto const pos = offset( value );
+						bitmap[pos / 64] |= uint64_t( 1 ) << (pos % 64);
+					}
+				}
+
+				void build_bitmap( std::false_type ) { }
+
+				uint64_t offset( const value_type& value ) const {
+					using unsigned_type = typename std::make_unsigned<value_type>::type;
+					return static_cast<unsigned_type>(static_cast<unsigned_type>(value) - static_cast<unsigned_type>(values.front( )));
+				}
+
+				uint64_t bitmap_bits( ) const {
+					return offset( values.back( ) ) + 1;
+				}
+
+				bool contains( const value_type& test_val, std::true_type ) const {
+					if( !bitmap.empty( ) ) {
+						auto const pos = offset( test_val );
+						return pos < bitmap.size( ) * 64 && 0 != (bitmap[pos / 64] & (uint64_t( 1 ) << (pos % 64)));
+					}
+					return contains( test_val, std::false_type( ) );
+				}
+
+				bool contains( const value_type& test_val, std::false_type ) const {
+					return search( test_val, is_less_comparable<value_type>( ) );
+				}
+
+				bool search( const value_type& test_val, std::true_type ) const {
+					return std::binary_search( values.begin( ), values.end( ), test_val );
+				}
+
+				bool search( const value_type& test_val, std::false_type ) const {
+					return values.end( ) != std::find( values.begin( ), values.end( ), test_val );
+				}
+			};
+
+			// Simplifications.  The generic versions keep both sides, the overloads 
+			// below fold known pairs into a single cheaper predicate.
+			template<typename Lhs, typename Rhs>
+			and_pred<Lhs, Rhs> make_and( Lhs lhs, Rhs rhs ) {
+				return and_pred<Lhs, Rhs>( std::move( lhs ), std::move( rhs ) );
 			}
 
-			template<typename value_type, typename Func>
-			bool is_none_of_impl( value_type value, Func func ) {
-				return !func( value );
+			template<typename T>
+			in_range<T, false, false> make_and( compare_to<T, std::greater<T>> lhs, compare_to<T, std::less<T>> rhs ) {
+				return in_range<T, false, false>( std::move( lhs.value ), std::move( rhs.value ) );
 			}
 
-			template<typename value_type, typename Func, typename ...Funcs>
-			bool is_all_of_impl( value_type value, Func func, Funcs... funcs ) {
-				if( func( value ) ) {
-					return is_all_of_impl( value, funcs... );
-				}
-				return false;
+			template<typename T>
+			in_range<T, true, false> make_and( compare_to<T, std::greater_equal<T>> lhs, compare_to<T, std::less<T>> rhs ) {
+				return in_range<T, true, false>( std::move( lhs.value ), std::move( rhs.value ) );
 			}
 
-			template<typename value_type, typename Func>
-			bool is_all_of_impl( value_type value, Func func ) {
-				return func( value );
+			template<typename T>
+			in_range<T, false, true> make_and( compare_to<T, std::greater<T>> lhs, compare_to<T, std::less_equal<T>> rhs ) {
+				return in_range<T, false, true>( std::move( lhs.value ), std::move( rhs.value ) );
 			}
 
-			template<typename value_type, typename Func, typename ...Funcs>
-			bool is_any_of_impl( value_type value, Func func, Funcs... funcs ) {
-				if( !func( value ) ) {
-					return is_any_of_impl( value, funcs... );
-				}
-				return true;
+			template<typename T>
+			in_range<T, true, true> make_and( compare_to<T, std::greater_equal<T>> lhs, compare_to<T, std::less_equal<T>> rhs ) {
+				return in_range<T, true, true>( std::move( lhs.value ), std::move( rhs.value ) );
 			}
 
-			template<typename value_type, typename Func>
-			bool is_any_of_impl( value_type value, Func func ) {
-				return func( value );
+			template<typename T>
+			in_range<T, false, false> make_and( compare_to<T, std::less<T>> lhs, compare_to<T, std::greater<T>> rhs ) {
+				return make_and( std::move( rhs ), std::move( lhs ) );
 			}
-		}
 
-		// is_none_of
-		template<typename value_type, typename ...Funcs>
-		std::function <bool( value_type )> is_none_of( std::function<bool(value_type)> pred, Funcs... predicate_list ) {
-			return[pred, predicate_list...]( const value_type& test_value ) {
-				return impl::is_none_of_impl( test_value, pred, predicate_list... );
+			template<typename T>
+			in_range<T, true, false> make_and( compare_to<T, std::less<T>> lhs, compare_to<T, std::greater_equal<T>> rhs ) {
+				return make_and( std::move( rhs ), std::move( lhs ) );
+			}
+
+			template<typename T>
+			in_range<T, false, true> make_and( compare_to<T, std::less_equal<T>> lhs, compare_to<T, std::greater<T>> rhs ) {
+				return make_and( std::move( rhs ), std::move( lhs ) );
+			}
+
+			template<typename T>
+			in_range<T, true, true> make_and( compare_to<T, std::less_equal<T>> lhs, compare_to<T, std::greater_equal<T>> rhs ) {
+				return make_and( std::move( rhs ), std::move( lhs ) );
+			}
+
+			template<typename Lhs, typename Rhs>
+			or_pred<Lhs, Rhs> make_or( Lhs lhs, Rhs rhs ) {
+				return or_pred<Lhs, Rhs>( std::move( lhs ), std::move( rhs ) );
+			}
+
+			template<typename T>
+			one_of<T> make_or( compare_to<T, std::equal_to<T>> lhs, compare_to<T, std::equal_to<T>> rhs ) {
+				return one_of<T>( std::vector<T>{ std::move( lhs.value ), std::move( rhs.value ) } );
+			}
+
+			template<typename T>
+			one_of<T> make_or( one_of<T> lhs, compare_to<T, std::equal_to<T>> rhs ) {
+				return lhs.merge( one_of<T>( std::vector<T>{ std::move( rhs.value ) } ) );
+			}
+
+			template<typename T>
+			one_of<T> make_or( compare_to<T, std::equal_to<T>> lhs, one_of<T> rhs ) {
+				return make_or( std::move( rhs ), std::move( lhs ) );
+			}
+
+			template<typename T>
+			one_of<T> make_or( one_of<T> lhs, one_of<T> rhs ) {
+				return lhs.merge( rhs );
+			}
+
+			template<typename Lhs, typename Rhs, typename = typename std::enable_if<is_predicate<Lhs>::value || is_predicate<Rhs>::value>::type>
+			auto operator&&( Lhs lhs, Rhs rhs ) -> decltype(make_and( std::move( lhs ), std::move( rhs ) )) {
+				return make_and( std::move( lhs ), std::move( rhs ) );
+			}
+
+			template<typename Lhs, typename Rhs, typename = typename std::enable_if<is_predicate<Lhs>::value || is_predicate<Rhs>::value>::type>
+			auto operator||( Lhs lhs, Rhs rhs ) -> decltype(make_or( std::move( lhs ), std::move( rhs ) )) {
+				return make_or( std::move( lhs ), std::move( rhs ) );
+			}
+
+			template<typename Pred, typename = typename std::enable_if<is_predicate<Pred>::value>::type>
+			not_pred<Pred> operator!( Pred pred ) {
+				return not_pred<Pred>( std::move( pred ) );
+			}
+
+			// The type fold_and and fold_or return.  A trailing decltype cannot name
+			// the recursive call, so the type is folded here instead
+			template<typename ...Preds>
+			struct fold_and_result;
+
+			template<typename Pred>
+			struct fold_and_result<Pred> {
+				using type = Pred;
 			};
-		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> is_none_of( std::function<bool( value_type )> pred ) {
-			return[pred]( value_type test_value ) {
-				return !pred( std::move( test_value ) );
+			template<typename Pred, typename Pred2, typename ...Preds>
+			struct fold_and_result<Pred, Pred2, Preds...>: fold_and_result<decltype(make_and( std::declval<Pred>( ), std::declval<Pred2>( ) )), Preds...> { };
+
+			template<typename ...Preds>
+			struct fold_or_result;
+
+			template<typename Pred>
+			struct fold_or_result<Pred> {
+				using type = Pred;
 			};
+
+			template<typename Pred, typename Pred2, typename ...Preds>
+			struct fold_or_result<Pred, Pred2, Preds...>: fold_or_result<decltype(make_or( std::declval<Pred>( ), std::declval<Pred2>( ) )), Preds...> { };
+
+			template<typename Pred>
+			Pred fold_and( Pred pred ) {
+				return pred;
+			}
+
+			template<typename Pred, typename Pred2, typename ...Preds>
+			typename fold_and_result<Pred, Pred2, Preds...>::type fold_and( Pred pred, Pred2 pred2, Preds... preds ) {
+				return fold_and( make_and( std::move( pred ), std::move( pred2 ) ), std::move( preds )... );
+			}
+
+			template<typename Pred>
+			Pred fold_or( Pred pred ) {
+				return pred;
+			}
+
+			template<typename Pred, typename Pred2, typename ...Preds>
+			typename fold_or_result<Pred, Pred2, Preds...>::type fold_or( Pred pred, Pred2 pred2, Preds... preds ) {
+				return fold_or( make_or( std::move( pred ), std::move( pred2 ) ), std::move( preds )... );
+			}
+		}	// namespace impl
+
+		// Where clauses
+
+		template<typename value_type, typename BinaryComp = std::less<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_less( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
 		}
-		//////////////////////////////////////////////////////////////////////////
 
-		// is_all_of
-		template<typename value_type, typename ...Funcs>
-		std::function <bool( value_type )> is_all_of( std::function<bool( value_type )> pred, Funcs... predicate_list ) {
-			return[pred, predicate_list...]( const value_type& test_value ) {
-				return impl::is_all_of_impl( test_value, pred, predicate_list... );
-			};
+		template<typename value_type, typename BinaryComp = std::less_equal<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_less_or_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
 		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> is_all_of( std::function<bool( value_type )> pred ) {
-			return[pred]( value_type test_value ) {
-				return pred( std::move( test_value ) );
-			};
+		template<typename value_type, typename BinaryComp = std::greater<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_greater( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
 		}
 
-		// is_any_of
-		template<typename value_type, typename ...Funcs>
-		std::function <bool( value_type )> is_any_of( std::function<bool( value_type )> pred, Funcs... predicate_list ) {
-			return[pred, predicate_list...]( const value_type& test_value ) {
-				return impl::is_any_of_impl( test_value, pred, predicate_list... );
-			};
+		template<typename value_type, typename BinaryComp = std::greater_equal<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_greater_or_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
 		}
 
-		template<typename value_type>
-		std::function <bool( value_type )> is_any_of( std::function<bool( value_type )> pred ) {
-			return[pred]( value_type test_value ) {
-				return pred( std::move( test_value ) );
-			};
+		template<typename value_type, typename BinaryComp = std::equal_to<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
+		}
+
+		template<typename value_type, typename BinaryComp = std::not_equal_to<value_type>>
+		impl::compare_to<value_type, BinaryComp> is_not_equal( value_type value, BinaryComp comp = BinaryComp( ) ) {
+			return impl::compare_to<value_type, BinaryComp>( std::move( value ), std::move( comp ) );
+		}
+
+		template<typename Lhs, typename Rhs>
+		auto logic_or( Lhs lhs, Rhs rhs ) -> decltype(impl::make_or( std::move( lhs ), std::move( rhs ) )) {
+			return impl::make_or( std::move( lhs ), std::move( rhs ) );
+		}
+
+		template<typename Lhs, typename Rhs>
+		auto logic_and( Lhs lhs, Rhs rhs ) -> decltype(impl::make_and( std::move( lhs ), std::move( rhs ) )) {
+			return impl::make_and( std::move( lhs ), std::move( rhs ) );
 		}
 
 		template<typename value_type>
-		std::function <bool( value_type )> logic_not( std::function <bool( value_type )> pred ) {
-			return[pred]( const value_type& test_val ) {
-				return !pred( test_val );
+		std::function <bool( const value_type& )> any_of( std::initializer_list<std::function<bool( const value_type& )>> preds ) {
+			return[preds]( const value_type& test_value ) {
+				for( auto& pred: preds ) {
+					if( pred( test_value ) ) {
+						return true;
+					}
+				}
+				return false;
 			};
 		}
 
+		template<typename Pred>
+		impl::not_pred<Pred> logic_not( Pred pred ) {
+			return impl::not_pred<Pred>( std::move( pred ) );
+		}
+
+		// is_none_of
+		template<typename Pred, typename ...Preds>
+		auto is_none_of( Pred pred, Preds... predicate_list ) -> decltype(logic_not( impl::fold_or( std::move( pred ), std::move( predicate_list )... ) )) {
+			return logic_not( impl::fold_or( std::move( pred ), std::move( predicate_list )... ) );
+		}
+
+		// is_all_of
+		template<typename Pred, typename ...Preds>
+		auto is_all_of( Pred pred, Preds... predicate_list ) -> decltype(impl::fold_and( std::move( pred ), std::move( predicate_list )... )) {
+			return impl::fold_and( std::move( pred ), std::move( predicate_list )... );
+		}
+
+		// is_any_of
+		// Equality tests are merged into one membership test when they are adjacent
+		template<typename Pred, typename ...Preds>
+		auto is_any_of( Pred pred, Preds... predicate_list ) -> decltype(impl::fold_or( std::move( pred ), std::move( predicate_list )... )) {
+			return impl::fold_or( std::move( pred ), std::move( predicate_list )... );
+		}
+
 		template<typename value_type>
-		std::function <bool( value_type )> is_even( ) {
-			return[]( const value_type& test_val ) {
-				return 0 == test_val % 2;
-			};
+		impl::even_pred<value_type> is_even( ) {
+			return impl::even_pred<value_type>( );
 		}
 
 		template<typename value_type>
-		std::function <bool( value_type )> is_odd( ) {
-			return[]( const value_type& test_val ) {
-				return 0 != test_val % 2;
-			};
+		impl::odd_pred<value_type> is_odd( ) {
+			return impl::odd_pred<value_type>( );
 		}
 
 
@@ -1,20 +1,289 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 #include "filtered_range_class.h"
+#include "filtered_range_parallel.h"
 
 namespace daw {
-	namespace range {		
-		template<typename value_type>
+	namespace range {
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: A set of FilteredRange shards, such as one per day or per
+		/// tenant, queried as one.  Each call runs on every shard, the shards
+		/// spread over at most thread_count( ) threads of the group's policy,
+		/// and returns a new group.
+		/// merge and merge_unique combine the shards' sorted output with a k-way
+		/// merge instead of appending them together first.
+		template<typename value_type, typename Storage = impl::ref_storage<value_type>>
 		class FilteredRangeGroup {
 		public:
-			FilteredRangeGroup& operator=(FilteredRangeGroup rhs);
-			FilteredRangeGroup( FilteredRangeGroup&& other );
-			FilteredRangeGroup( ) = default;
+			using range_type = FilteredRange<value_type, Storage>;
+
+			FilteredRangeGroup( ): m_ranges( ), m_policy( execution::par ) { }
+
+			explicit FilteredRangeGroup( std::vector<range_type> ranges, execution::policy policy = execution::par ): m_ranges( std::move( ranges ) ), m_policy( std::move( policy ) ) { }
+
+			FilteredRangeGroup( std::initializer_list<range_type> ranges ): m_ranges( ranges ), m_policy( execution::par ) { }
+
+			FilteredRangeGroup& operator=(FilteredRangeGroup rhs) {
+				m_ranges = std::move( rhs.m_ranges );
+				m_policy = std::move( rhs.m_policy );
+				return *this;
+			}
+
+			FilteredRangeGroup( FilteredRangeGroup&& other ): m_ranges( std::move( other.m_ranges ) ), m_policy( std::move( other.m_policy ) ) { }
 			FilteredRangeGroup( const FilteredRangeGroup& ) = default;
-			bool operator==(const FilteredRangeGroup&) const;
 			~FilteredRangeGroup( ) = default;
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Groups are equal when each pair of shards holds the same
+			/// values in the same order
+			bool operator==(const FilteredRangeGroup& rhs) const {
+				if( m_ranges.size( ) != rhs.m_ranges.size( ) ) {
+					return false;
+				}
+				for( size_t n = 0; n < m_ranges.size( ); ++n ) {
+					auto lhs_values = shard( n ).to_vector( );
+					auto rhs_values = rhs.shard( n ).to_vector( );
+					if( lhs_values != rhs_values ) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a group with range added as another shard
+			FilteredRangeGroup add( range_type range ) const {
+				auto result = *this;
+				result.m_ranges.push_back( std::move( range ) );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a group whose operations run on the threads of policy
+			FilteredRangeGroup with_policy( execution::policy policy ) const {
+				auto result = *this;
+				result.m_policy = std::move( policy );
+				return result;
+			}
+
+			size_t shard_count( ) const {
+				return m_ranges.size( );
+			}
+
+			range_type shard( size_t pos ) const {
+				return m_ranges.at( pos );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Adds a predicate to every shard that when false for a value
+			/// filters out the value
+			FilteredRangeGroup where( typename range_type::predicate_type predicate ) const {
+				return transform_serial( [&predicate]( const range_type& range ) { return range.where( predicate ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Clears all where predicates of every shard
+			FilteredRangeGroup clear_where( ) const {
+				return transform_serial( []( const range_type& range ) { return range.clear_where( ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sorts each shard.  See FilteredRange::sort
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRangeGroup sort( LessThanCompare comp = LessThanCompare( ) ) const {
+				return transform( [&comp]( const range_type& range ) { return range.sort( comp ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Stable sorts each shard.  See FilteredRange::stable_sort
+			template<typename LessThanCompare = std::less<value_type>>
+			FilteredRangeGroup stable_sort( LessThanCompare comp = LessThanCompare( ) ) const {
+				return transform( [&comp]( const range_type& range ) { return range.stable_sort( comp ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Removes consecutive duplicates within each shard
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			FilteredRangeGroup unique( EqualToCompare comp = EqualToCompare( ) ) const {
+				return transform( [&comp]( const range_type& range ) { return range.unique( comp ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sorts and removes duplicates within each shard.  Values
+			/// in more than one shard are kept once per shard; see merge_unique
+			template<typename LessThanCompare = std::less<value_type>, typename EqualCompare = std::equal_to<value_type>>
+			FilteredRangeGroup sorted_unique( LessThanCompare scomp = LessThanCompare( ), EqualCompare ucomp = EqualCompare( ) ) const {
+				return transform( [&scomp, &ucomp]( const range_type& range ) { return range.sorted_unique( scomp, ucomp ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: On every valid element of every shard do something.  The
+			/// shards run concurrently, so func must be safe to call from several
+			/// threads at once
+			template<typename Func>
+			FilteredRangeGroup for_each( Func func ) const {
+				return transform( [&func]( const range_type& range ) { return range.for_each( func ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Copy all valid values to a std::vector, shard by shard
+			std::vector<value_type> to_vector( ) const {
+				auto result = std::vector<value_type>( );
+				for( auto range : m_ranges ) {
+					auto values = range.to_vector( );
+					result.insert( result.end( ), values.begin( ), values.end( ) );
+				}
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of valid values over all shards
+			size_t size( ) const {
+				auto counts = std::vector<size_t>( m_ranges.size( ) );
+				for_each_shard( [&]( size_t n ) { counts[n] = m_ranges[n].count( ); } );
+				size_t result = 0;
+				for( auto count : counts ) {
+					result += count;
+				}
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if value is in any shard
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			bool contains( const value_type& value, EqualToCompare comp = EqualToCompare( ) ) const {
+				for( auto& range : m_ranges ) {
+					if( range.contains( value, comp ) ) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sorts the shards in parallel and combines them with a
+			/// k-way merge into one range sorted by comp.  Equivalent values keep
+			/// the order of their shards.  Shards must be over the same source
+			/// unless they hold references
+			template<typename LessThanCompare = std::less<value_type>>
+			range_type merge( LessThanCompare comp = LessThanCompare( ) ) const {
+				return merge_impl( sort( comp ), comp, []( const value_type&, const value_type& ) { return false; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sorts and removes duplicates from the shards in parallel and
+			/// merges them, dropping values already taken from another shard.  The
+			/// result is the sorted_unique of all the shards' values together
+			template<typename LessThanCompare = std::less<value_type>, typename EqualCompare = std::equal_to<value_type>>
+			range_type merge_unique( LessThanCompare scomp = LessThanCompare( ), EqualCompare ucomp = EqualCompare( ) ) const {
+				return merge_impl( sorted_unique( scomp, ucomp ), scomp, ucomp );
+			}
+
 		private:
-			std::vector<FilteredRange<value_type>> m_ranges;
+			std::vector<range_type> m_ranges;
+			execution::policy m_policy;
+
+			// Calls func( n ) for every shard.  Each worker thread takes a block
+			// of shards and steals from the others when done, so the thread count
+			// stays within the policy however many shards there are
+			template<typename Func>
+			void for_each_shard( Func func ) const {
+				impl::parallel_for_chunks( m_policy.with_chunk_size( 1 ), m_ranges.size( ), [&func]( size_t first, size_t last ) {
+					for( auto n = first; n < last; ++n ) {
+						func( n );
+					}
+				} );
+			}
+
+			// Runs func on every shard in parallel
+			template<typename Func>
+			FilteredRangeGroup transform( Func func ) const {
+				auto ranges = std::vector<range_type>( m_ranges );
+				for_each_shard( [&]( size_t n ) { ranges[n] = func( m_ranges[n] ); } );
+				return FilteredRangeGroup( std::move( ranges ), m_policy );
+			}
+
+			// Runs func on every shard on the calling thread.  For O(1) copies,
+			// where starting threads would cost more than the work
+			template<typename Func>
+			FilteredRangeGroup transform_serial( Func func ) const {
+				auto ranges = std::vector<range_type>( );
+				ranges.reserve( m_ranges.size( ) );
+				for( auto& range : m_ranges ) {
+					ranges.push_back( func( range ) );
+				}
+				return FilteredRangeGroup( std::move( ranges ), m_policy );
+			}
+
+			// Merges the sorted shards of group, skipping a value when equal to
+			// the last one taken
+			template<typename LessThanCompare, typename EqualCompare>
+			static range_type merge_impl( const FilteredRangeGroup& group, LessThanCompare comp, EqualCompare equal ) {
+				auto const & ranges = group.m_ranges;
+				if( ranges.empty( ) ) {
+					throw std::out_of_range( "merge of an empty FilteredRangeGroup" );
+				}
+				size_t total = 0;
+				for( auto& range : ranges ) {
+					if( !ranges.front( ).m_storage.same_source( range.m_storage ) ) {
+						throw std::invalid_argument( "FilteredRangeGroup::merge requires shards over the same source" );
+					}
+					total += range.m_value_refs.get( ).size( );
+				}
+				auto const & storage = ranges.front( ).m_storage;
+				// A min heap of shard positions.  Ties go to the earlier shard
+				using cursor = std::pair<size_t, size_t>;
+				auto cursor_value = [&ranges, &storage]( const cursor& cur ) -> const value_type& {
+					return storage.deref( ranges[cur.first].m_value_refs.get( )[cur.second] );
+				};
+				auto heap_comp = [&]( const cursor& lhs, const cursor& rhs ) {
+					auto const & lhs_value = cursor_value( lhs );
+					auto const & rhs_value = cursor_value( rhs );
+					if( comp( rhs_value, lhs_value ) ) {
+						return true;
+					}
+					return !comp( lhs_value, rhs_value ) && rhs.first < lhs.first;
+				};
+				auto heap = std::vector<cursor>( );
+				for( size_t n = 0; n < ranges.size( ); ++n ) {
+					if( !ranges[n].m_value_refs.get( ).empty( ) ) {
+						heap.push_back( cursor( n, 0 ) );
+					}
+				}
+				std::make_heap( heap.begin( ), heap.end( ), heap_comp );
+				auto merged = ranges.front( ).new_elements( );
+				merged.reserve( total );
+				while( !heap.empty( ) ) {
+					std::pop_heap( heap.begin( ), heap.end( ), heap_comp );
+					auto& cur = heap.back( );
+					auto const & element = ranges[cur.first].m_value_refs.get( )[cur.second];
+					if( merged.empty( ) || !equal( storage.deref( merged.back( ) ), storage.deref( element ) ) ) {
+						merged.push_back( element );
+					}
+					if( ++cur.second < ranges[cur.first].m_value_refs.get( ).size( ) ) {
+						std::push_heap( heap.begin( ), heap.end( ), heap_comp );
+					} else {
+						heap.pop_back( );
+					}
+				}
+				auto result = range_type( std::move( merged ), { }, storage );
+				result.template mark_sorted<LessThanCompare>( );
+				return result;
+			}
 		};	// class FilteredRangeGroup
-	}	// namespace range	
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Creates a FilteredRangeGroup with one shard per range
+		template<typename value_type, typename Storage>
+		FilteredRangeGroup<value_type, Storage> create_filtered_range_group( std::vector<FilteredRange<value_type, Storage>> ranges ) {
+			return FilteredRangeGroup<value_type, Storage>( std::move( ranges ) );
+		}
+	}	// namespace range
 }	// namespace daw
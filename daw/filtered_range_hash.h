@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			template<typename T, typename = void>
+			struct is_hashable: std::false_type { };
+
+			template<typename T>
+			struct is_hashable<T, decltype(void( std::hash<T>( )( std::declval<const T&>( ) ) ))>: std::true_type { };
+
+			template<typename T, typename = void>
+			struct is_less_comparable: std::false_type { };
+
+			template<typename T>
+			struct is_less_comparable<T, decltype(void( std::declval<const T&>( ) < std::declval<const T&>( ) ))>: std::true_type { };
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: An open addressing hash table with linear probing.  Keys are
+			/// kept densely in insertion order so callers can keep per key data in
+			/// parallel vectors indexed by the position find_or_insert returns.
+			/// The keys are allocated by Allocator
+			template<typename Key, typename Hash, typename KeyEqual, typename Allocator = std::allocator<Key>>
+			class open_hash_table {
+			public:
+				using key_vector = std::vector<Key, Allocator>;
+
+				open_hash_table( size_t expected_size, Hash hash, KeyEqual equal, const Allocator& alloc = Allocator( ) ): m_keys( alloc ), m_hashes( ), m_slots( ), m_shift( 64 ), m_hash( std::move( hash ) ), m_equal( std::move( equal ) ) {
+					m_keys.reserve( expected_size );
+					m_hashes.reserve( expected_size );
+					rehash( expected_size );
+				}
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Returns the position of key and whether it was inserted
+				std::pair<size_t, bool> find_or_insert( const Key& key ) {
+					if( 2 * (m_keys.size( ) + 1) > m_slots.size( ) ) {
+						rehash( 2 * m_keys.size( ) + 2 );
+					}
+					auto const hash = static_cast<uint64_t>(m_hash( key ));
+					auto slot = probe( key, hash );
+					if( 0 != m_slots[slot] ) {
+						return std::make_pair( m_slots[slot] - 1, false );
+					}
+					m_keys.push_back( key );
+					m_hashes.push_back( hash );
+					m_slots[slot] = m_keys.size( );
+					return std::make_pair( m_keys.size( ) - 1, true );
+				}
+
+				bool insert( const Key& key ) {
+					return find_or_insert( key ).second;
+				}
+
+				bool contains( const Key& key ) const {
+					return 0 != m_slots[probe( key, static_cast<uint64_t>(m_hash( key )) )];
+				}
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Looks for a key with the given hash for which matches( key )
+				/// is true.  Allows lookups by something other than a Key
+				template<typename Matches>
+				bool contains_hashed( uint64_t hash, Matches matches ) const {
+					auto const mask = m_slots.size( ) - 1;
+					for( auto slot = home_slot( hash ); 0 != m_slots[slot]; slot = (slot + 1) & mask ) {
+						auto const pos = m_slots[slot] - 1;
+						if( m_hashes[pos] == hash && matches( m_keys[pos] ) ) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+				size_t size( ) const {
+					return m_keys.size( );
+				}
+
+				const key_vector& keys( ) const {
+					return m_keys;
+				}
+
+				key_vector release_keys( ) {
+					auto result = std::move( m_keys );
+					m_keys = key_vector( result.get_allocator( ) );
+					m_hashes.clear( );
+					std::fill( m_slots.begin( ), m_slots.end( ), 0 );
+					return result;
+				}
+
+			private:
+				key_vector m_keys;
+				std::vector<uint64_t> m_hashes;
+				std::vector<size_t> m_slots;	// 0 is empty, otherwise 1 + position in m_keys
+				size_t m_shift;
+				mutable Hash m_hash;
+				mutable KeyEqual m_equal;
+
+				// Fibonacci hashing spreads weak hashes such as the identity hash of integers
+				size_t home_slot( uint64_t hash ) const {
+					return static_cast<size_t>((hash * UINT64_C( 0x9E3779B97F4A7C15 )) >> m_shift);
+				}
+
+				size_t probe( const Key& key, uint64_t hash ) const {
+					auto const mask = m_slots.size( ) - 1;
+					auto slot = home_slot( hash );
+					while( 0 != m_slots[slot] ) {
+						auto const pos = m_slots[slot] - 1;
+						if( m_hashes[pos] == hash && m_equal( m_keys[pos], key ) ) {
+							break;
+						}
+						slot = (slot + 1) & mask;
+					}
+					return slot;
+				}
+
+				void rehash( size_t min_keys ) {
+					size_t bits = 1;
+					while( (size_t( 1 ) << bits) < 2 * min_keys ) {
+						++bits;
+					}
+					m_shift = 64 - bits;
+					m_slots.assign( size_t( 1 ) << bits, 0 );
+					auto const mask = m_slots.size( ) - 1;
+					for( size_t pos = 0; pos < m_keys.size( ); ++pos ) {
+						auto slot = home_slot( m_hashes[pos] );
+						while( 0 != m_slots[slot] ) {
+							slot = (slot + 1) & mask;
+						}
+						m_slots[slot] = pos + 1;
+					}
+				}
+			};	// class open_hash_table
+		}	// namespace impl
+	}	// namespace range
+}	// namespace daw
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+/// Summary: Define DAW_RANGE_INSTRUMENT before including the range headers
+/// to report every operation to the observer set with
+/// instrument::set_observer.  Without it the hooks expand to nothing and
+/// the observer is never called.
+#ifdef DAW_RANGE_INSTRUMENT
+#define DAW_RANGE_OPERATION( name, elements_in ) ::daw::range::impl::operation_scope daw_range_operation( name, elements_in )
+#define DAW_RANGE_OPERATION_OUT( elements_out ) daw_range_operation.set_elements_out( elements_out )
+#define DAW_RANGE_PREDICATE_CALL( pos ) ::daw::range::impl::operation_scope::record_predicate_call( pos )
+#define DAW_RANGE_ALLOCATION( bytes ) ::daw::range::impl::operation_scope::record_allocation( bytes )
+// The v120 toolset has no thread_local, only __declspec( thread )
+#if defined( _MSC_VER ) && _MSC_VER < 1900
+#define DAW_RANGE_THREAD_LOCAL __declspec( thread )
+#else
+#define DAW_RANGE_THREAD_LOCAL thread_local
+#endif
+#else
+#define DAW_RANGE_OPERATION( name, elements_in ) ((void)0)
+#define DAW_RANGE_OPERATION_OUT( elements_out ) ((void)0)
+#define DAW_RANGE_PREDICATE_CALL( pos ) ((void)0)
+#define DAW_RANGE_ALLOCATION( bytes ) ((void)0)
+#endif
+
+namespace daw {
+	namespace range {
+		namespace instrument {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: What one operation on a range did.  predicate_calls has an
+			/// entry for each where predicate, in the order they were added, that
+			/// counts the calls made on the operation's thread.  bytes_allocated
+			/// counts the element vectors the operation created or copied.
+			/// Operations that run others, such as sorted_unique running sort, are
+			/// reported after the operations they ran, and each call is counted
+			/// only by the innermost operation
+			struct operation_stats {
+				const char* name;
+				size_t elements_in;
+				size_t elements_out;
+				std::vector<size_t> predicate_calls;
+				size_t bytes_allocated;
+				std::chrono::nanoseconds elapsed;
+
+				operation_stats( const char* operation_name, size_t count_in ): name( operation_name ), elements_in( count_in ), elements_out( 0 ), predicate_calls( ), bytes_allocated( 0 ), elapsed( 0 ) { }
+			};	// struct operation_stats
+
+			using observer_type = std::function<void( const operation_stats& )>;
+
+			namespace impl {
+				inline std::shared_ptr<const observer_type>& observer_slot( ) {
+					static std::shared_ptr<const observer_type> result;
+					return result;
+				}
+			}	// namespace impl
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Sets the function called after each operation, on the
+			/// thread that ran it.  An empty function stops reporting
+			inline void set_observer( observer_type observer ) {
+				auto slot = observer ? std::make_shared<const observer_type>( std::move( observer ) ) : std::shared_ptr<const observer_type>( );
+				std::atomic_store( &impl::observer_slot( ), std::move( slot ) );
+			}
+
+			inline std::shared_ptr<const observer_type> current_observer( ) {
+				return std::atomic_load( &impl::observer_slot( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Totals of the reported operations by name.  Install with
+			/// set_observer( counters.observer( ) ) and keep the counters alive
+			/// while they are installed
+			class counters {
+			public:
+				struct totals {
+					size_t calls;
+					size_t elements_in;
+					size_t elements_out;
+					size_t predicate_calls;
+					size_t bytes_allocated;
+					std::chrono::nanoseconds elapsed;
+
+					totals( ): calls( 0 ), elements_in( 0 ), elements_out( 0 ), predicate_calls( 0 ), bytes_allocated( 0 ), elapsed( 0 ) { }
+				};	// struct totals
+
+				counters( ): m_mutex( ), m_totals( ) { }
+
+				counters( const counters& ) = delete;
+				counters& operator=(const counters&) = delete;
+
+				void add( const operation_stats& stats ) {
+					std::lock_guard<std::mutex> lock( m_mutex );
+					auto& total = m_totals[stats.name];
+					++total.calls;
+					total.elements_in += stats.elements_in;
+					total.elements_out += stats.elements_out;
+					for( auto calls : stats.predicate_calls ) {
+						total.predicate_calls += calls;
+					}
+					total.bytes_allocated += stats.bytes_allocated;
+					total.elapsed += stats.elapsed;
+				}
+
+				observer_type observer( ) {
+					return [this]( const operation_stats& stats ) { add( stats ); };
+				}
+
+				std::map<std::string, totals> snapshot( ) const {
+					std::lock_guard<std::mutex> lock( m_mutex );
+					return m_totals;
+				}
+
+				void clear( ) {
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_totals.clear( );
+				}
+
+			private:
+				mutable std::mutex m_mutex;
+				std::map<std::string, totals> m_totals;
+			};	// class counters
+		}	// namespace instrument
+
+#ifdef DAW_RANGE_INSTRUMENT
+		namespace impl {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Measures an operation from construction to destruction and
+			/// reports it to the observer.  Nothing is measured when no observer
+			/// is set at construction
+			class operation_scope {
+			public:
+				operation_scope( const char* name, size_t elements_in ): m_observer( instrument::current_observer( ) ), m_stats( name, elements_in ), m_start( ), m_parent( current( ) ) {
+					if( m_observer ) {
+						current( ) = this;
+						m_start = std::chrono::steady_clock::now( );
+					}
+				}
+
+				operation_scope( const operation_scope& ) = delete;
+				operation_scope& operator=(const operation_scope&) = delete;
+
+				~operation_scope( ) {
+					if( !m_observer ) {
+						return;
+					}
+					m_stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now( ) - m_start);
+					current( ) = m_parent;
+					try {
+						(*m_observer)( m_stats );
+					} catch( ... ) { }
+				}
+
+				void set_elements_out( size_t elements_out ) {
+					m_stats.elements_out = elements_out;
+				}
+
+				static void record_predicate_call( size_t pos ) {
+					auto scope = current( );
+					if( nullptr == scope ) {
+						return;
+					}
+					auto& calls = scope->m_stats.predicate_calls;
+					if( calls.size( ) <= pos ) {
+						calls.resize( pos + 1, 0 );
+					}
+					++calls[pos];
+				}
+
+				static void record_allocation( size_t bytes ) {
+					auto scope = current( );
+					if( nullptr != scope ) {
+						scope->m_stats.bytes_allocated += bytes;
+					}
+				}
+
+			private:
+				std::shared_ptr<const instrument::observer_type> m_observer;
+				instrument::operation_stats m_stats;
+				std::chrono::steady_clock::time_point m_start;
+				operation_scope* m_parent;
+
+				static operation_scope*& current( ) {
+					static DAW_RANGE_THREAD_LOCAL operation_scope* result = nullptr;
+					return result;
+				}
+			};	// class operation_scope
+		}	// namespace impl
+#endif
+	}	// namespace range
+}	// namespace daw
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#if defined( __has_include )
+#if __has_include( <memory_resource> ) && __cplusplus >= 201703L
+#include <memory_resource>
+#define DAW_RANGE_HAS_PMR
+#endif
+#elif defined( _MSVC_LANG ) && _MSVC_LANG >= 201703L
+#include <memory_resource>
+#define DAW_RANGE_HAS_PMR
+#endif
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			// Has the strictest fundamental alignment, like std::max_align_t which
+			// Visual Studio 2013 does not have
+			union max_align_t {
+				long double long_double_value;
+				long long long_long_value;
+				double double_value;
+				void* pointer_value;
+				void( *function_value )( );
+			};
+
+			size_t const max_alignment = std::alignment_of<max_align_t>::value;
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Where a range gets the memory for its buffers.  Mirrors
+		/// std::pmr::memory_resource, which is not available before C++17
+		class memory_resource {
+		public:
+			virtual ~memory_resource( ) = default;
+
+			void* allocate( size_t bytes, size_t alignment = impl::max_alignment ) {
+				return do_allocate( bytes, alignment );
+			}
+
+			void deallocate( void* ptr, size_t bytes, size_t alignment = impl::max_alignment ) {
+				do_deallocate( ptr, bytes, alignment );
+			}
+
+			bool is_equal( const memory_resource& other ) const {
+				return this == &other || do_is_equal( other );
+			}
+
+		protected:
+			virtual void* do_allocate( size_t bytes, size_t alignment ) = 0;
+			virtual void do_deallocate( void* ptr, size_t bytes, size_t alignment ) = 0;
+
+			virtual bool do_is_equal( const memory_resource& other ) const {
+				return this == &other;
+			}
+		};	// class memory_resource
+
+		namespace impl {
+			class new_delete_resource_t: public memory_resource {
+			protected:
+				void* do_allocate( size_t bytes, size_t ) override {
+					return ::operator new( bytes );
+				}
+
+				void do_deallocate( void* ptr, size_t, size_t ) override {
+					::operator delete( ptr );
+				}
+			};	// class new_delete_resource_t
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: The global heap.  Used by ranges unless given another resource
+		inline memory_resource* new_delete_resource( ) {
+			static impl::new_delete_resource_t result;
+			return &result;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Hands out memory from large blocks by bumping a pointer and
+		/// never frees single allocations.  Everything is released at once by
+		/// release( ) or the destructor, so a whole chain of operations can run
+		/// out of one arena without touching the global heap for each buffer.
+		/// Safe to use from several threads, such as the workers of a parallel
+		/// policy.  Every range using the arena must be destroyed before it
+		class monotonic_arena: public memory_resource {
+		public:
+			explicit monotonic_arena( size_t initial_block_size = 64 * 1024, memory_resource* upstream = new_delete_resource( ) ): m_mutex( ), m_blocks( ), m_upstream( upstream ), m_next_block_size( std::max( initial_block_size, size_t( 256 ) ) ), m_current( nullptr ), m_remaining( 0 ), m_bytes_allocated( 0 ) { }
+
+			monotonic_arena( const monotonic_arena& ) = delete;
+			monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+			~monotonic_arena( ) {
+				release( );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns every block to the upstream resource
+			void release( ) {
+				std::lock_guard<std::mutex> lock( m_mutex );
+				for( auto& block : m_blocks ) {
+					m_upstream->deallocate( block.first, block.second );
+				}
+				m_blocks.clear( );
+				m_current = nullptr;
+				m_remaining = 0;
+				m_bytes_allocated = 0;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Bytes handed out since the last release
+			size_t bytes_allocated( ) const {
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_bytes_allocated;
+			}
+
+		protected:
+			void* do_allocate( size_t bytes, size_t alignment ) override {
+				std::lock_guard<std::mutex> lock( m_mutex );
+				void* result = align( bytes, alignment );
+				if( nullptr == result ) {
+					add_block( bytes + alignment );
+					result = align( bytes, alignment );
+				}
+				m_current = static_cast<char*>(result) + bytes;
+				m_remaining -= bytes;
+				m_bytes_allocated += bytes;
+				return result;
+			}
+
+			void do_deallocate( void*, size_t, size_t ) override { }
+
+		private:
+			mutable std::mutex m_mutex;
+			std::vector<std::pair<void*, size_t>> m_blocks;
+			memory_resource* m_upstream;
+			size_t m_next_block_size;
+			char* m_current;
+			size_t m_remaining;
+			size_t m_bytes_allocated;
+
+			void* align( size_t bytes, size_t alignment ) {
+				if( nullptr == m_current ) {
+					return nullptr;
+				}
+				void* ptr = m_current;
+				if( nullptr == std::align( alignment, bytes, ptr, m_remaining ) ) {
+					return nullptr;
+				}
+				m_current = static_cast<char*>(ptr);
+				return ptr;
+			}
+
+			void add_block( size_t min_size ) {
+				auto const size = std::max( m_next_block_size, min_size );
+				auto block = m_upstream->allocate( size );
+				m_blocks.emplace_back( block, size );
+				m_current = static_cast<char*>(block);
+				m_remaining = size;
+				m_next_block_size = size * 2;
+			}
+		};	// class monotonic_arena
+
+#ifdef DAW_RANGE_HAS_PMR
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Lets a range use a std::pmr::memory_resource, such as a
+		/// std::pmr::monotonic_buffer_resource.  The adapted resource must
+		/// outlive the adapter
+		class pmr_resource: public memory_resource {
+		public:
+			explicit pmr_resource( std::pmr::memory_resource* resource ): m_resource( resource ) { }
+
+		protected:
+			void* do_allocate( size_t bytes, size_t alignment ) override {
+				return m_resource->allocate( bytes, alignment );
+			}
+
+			void do_deallocate( void* ptr, size_t bytes, size_t alignment ) override {
+				m_resource->deallocate( ptr, bytes, alignment );
+			}
+
+			bool do_is_equal( const memory_resource& other ) const override {
+				auto const adapted = dynamic_cast<const pmr_resource*>(&other);
+				return nullptr != adapted && m_resource->is_equal( *adapted->m_resource );
+			}
+
+		private:
+			std::pmr::memory_resource* m_resource;
+		};	// class pmr_resource
+#endif
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: An allocator that gets its memory from a memory_resource,
+		/// like std::pmr::polymorphic_allocator.  Copies of a container keep
+		/// the resource of the original
+		template<typename T>
+		class resource_allocator {
+		public:
+			using value_type = T;
+
+			resource_allocator( ): m_resource( new_delete_resource( ) ) { }
+
+			resource_allocator( memory_resource* resource ): m_resource( nullptr == resource ? new_delete_resource( ) : resource ) { }
+
+			template<typename U>
+			resource_allocator( const resource_allocator<U>& other ): m_resource( other.resource( ) ) { }
+
+			T* allocate( size_t count ) {
+				if( count > static_cast<size_t>(-1) / sizeof( T ) ) {
+					throw std::bad_alloc( );
+				}
+				return static_cast<T*>(m_resource->allocate( count * sizeof( T ), std::alignment_of<T>::value ));
+			}
+
+			void deallocate( T* ptr, size_t count ) {
+				m_resource->deallocate( ptr, count * sizeof( T ), std::alignment_of<T>::value );
+			}
+
+			memory_resource* resource( ) const {
+				return m_resource;
+			}
+
+		private:
+			memory_resource* m_resource;
+		};	// class resource_allocator
+
+		template<typename T, typename U>
+		bool operator==(const resource_allocator<T>& lhs, const resource_allocator<U>& rhs) {
+			return lhs.resource( )->is_equal( *rhs.resource( ) );
+		}
+
+		template<typename T, typename U>
+		bool operator!=(const resource_allocator<T>& lhs, const resource_allocator<U>& rhs) {
+			return !(lhs == rhs);
+		}
+	}	// namespace range
+}	// namespace daw
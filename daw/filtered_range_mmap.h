@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "filtered_range_class.h"
+
+namespace daw {
+	namespace range {
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: How the records of a mapped_file will be visited
+		enum class access_hint { normal, sequential, random };
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: A binary file of value_type records mapped into memory.
+		/// The mapping is private, so values changed through it are never written
+		/// back to the file.  Pages are read in by the OS as they are touched.
+		template<typename value_type>
+		class mapped_file {
+		public:
+			static_assert(std::is_trivially_copyable<value_type>::value, "mapped_file requires a trivially copyable value_type");
+
+			explicit mapped_file( const std::string& path, access_hint hint = access_hint::normal ): m_data( nullptr ), m_bytes( 0 ) {
+				open( path );
+				if( 0 != m_bytes % sizeof( value_type ) ) {
+					close( );
+					throw std::length_error( path + " is not a whole number of records" );
+				}
+				advise( hint );
+			}
+
+			mapped_file( const mapped_file& ) = delete;
+			mapped_file& operator=(const mapped_file&) = delete;
+
+			~mapped_file( ) {
+				close( );
+			}
+
+			value_type* data( ) const {
+				return static_cast<value_type*>(m_data);
+			}
+
+			size_t size( ) const {
+				return m_bytes / sizeof( value_type );
+			}
+
+			bool empty( ) const {
+				return 0 == m_bytes;
+			}
+
+			value_type* begin( ) const {
+				return data( );
+			}
+
+			value_type* end( ) const {
+				return data( ) + size( );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Tells the OS how the records will be visited so it can
+			/// read ahead for sequential scans or not for random lookups.  Only a
+			/// hint, ignored where unsupported
+			void advise( access_hint hint ) const {
+#ifndef _WIN32
+				if( empty( ) ) {
+					return;
+				}
+				auto advice = MADV_NORMAL;
+				if( access_hint::sequential == hint ) {
+					advice = MADV_SEQUENTIAL;
+				} else if( access_hint::random == hint ) {
+					advice = MADV_RANDOM;
+				}
+				::madvise( m_data, m_bytes, advice );
+#else
+				(void)hint;
+#endif
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Asks the OS to start reading count records from first in
+			/// the background, e.g. the next chunk of a scan.  Only a hint.  The
+			/// range operations never call it; a caller that walks the file in
+			/// chunks calls it for the next chunk itself.  Whole file scans rely
+			/// on the read ahead from access_hint::sequential instead
+			void prefetch( size_t first, size_t count ) const {
+				if( first >= size( ) || 0 == count ) {
+					return;
+				}
+				if( count > size( ) - first ) {
+					count = size( ) - first;
+				}
+				auto const start = reinterpret_cast<uintptr_t>(data( ) + first);
+				auto const last = start + count * sizeof( value_type );
+#ifndef _WIN32
+				auto const page = static_cast<uintptr_t>(::sysconf( _SC_PAGESIZE ));
+				auto const aligned = start - start % page;
+				::madvise( reinterpret_cast<void*>(aligned), static_cast<size_t>(last - aligned), MADV_WILLNEED );
+#elif defined( _WIN32_WINNT ) && _WIN32_WINNT >= 0x0602
+				WIN32_MEMORY_RANGE_ENTRY range;
+				range.VirtualAddress = reinterpret_cast<void*>(start);
+				range.NumberOfBytes = static_cast<SIZE_T>(last - start);
+				::PrefetchVirtualMemory( ::GetCurrentProcess( ), 1, &range, 0 );
+#else
+				(void)last;
+#endif
+			}
+
+		private:
+			void* m_data;
+			size_t m_bytes;
+
+#ifdef _WIN32
+			void open( const std::string& path ) {
+				auto file = ::CreateFileA( path.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+				if( INVALID_HANDLE_VALUE == file ) {
+					throw std::system_error( static_cast<int>(::GetLastError( )), std::system_category( ), "Could not open " + path );
+				}
+				LARGE_INTEGER file_size;
+				if( !::GetFileSizeEx( file, &file_size ) ) {
+					auto const error = static_cast<int>(::GetLastError( ));
+					::CloseHandle( file );
+					throw std::system_error( error, std::system_category( ), "Could not get the size of " + path );
+				}
+				if( static_cast<unsigned long long>(file_size.QuadPart) > static_cast<unsigned long long>(SIZE_MAX) ) {
+					::CloseHandle( file );
+					throw std::length_error( path + " is too large to map in this address space" );
+				}
+				m_bytes = static_cast<size_t>(file_size.QuadPart);
+				if( 0 == m_bytes ) {
+					::CloseHandle( file );
+					return;
+				}
+				// A copy on write view lets values be changed without touching the file
+				auto mapping = ::CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+				::CloseHandle( file );
+				if( nullptr == mapping ) {
+					throw std::system_error( static_cast<int>(::GetLastError( )), std::system_category( ), "Could not map " + path );
+				}
+				m_data = ::MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+				auto const error = static_cast<int>(::GetLastError( ));
+				::CloseHandle( mapping );
+				if( nullptr == m_data ) {
+					throw std::system_error( error, std::system_category( ), "Could not map " + path );
+				}
+			}
+
+			void close( ) {
+				if( nullptr != m_data ) {
+					::UnmapViewOfFile( m_data );
+					m_data = nullptr;
+				}
+			}
+#else
+			void open( const std::string& path ) {
+				auto const fd = ::open( path.c_str( ), O_RDONLY );
+				if( fd < 0 ) {
+					throw std::system_error( errno, std::generic_category( ), "Could not open " + path );
+				}
+				struct stat file_stat;
+				if( 0 != ::fstat( fd, &file_stat ) ) {
+					auto const error = errno;
+					::close( fd );
+					throw std::system_error( error, std::generic_category( ), "Could not get the size of " + path );
+				}
+				if( static_cast<unsigned long long>(file_stat.st_size) > static_cast<unsigned long long>(SIZE_MAX) ) {
+					::close( fd );
+					throw std::length_error( path + " is too large to map in this address space" );
+				}
+				m_bytes = static_cast<size_t>(file_stat.st_size);
+				if( 0 == m_bytes ) {
+					::close( fd );
+					return;
+				}
+				// A private writable mapping lets values be changed without touching the file
+				auto const result = ::mmap( nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+				auto const error = errno;
+				::close( fd );
+				if( MAP_FAILED == result ) {
+					throw std::system_error( error, std::generic_category( ), "Could not map " + path );
+				}
+				m_data = result;
+			}
+
+			void close( ) {
+				if( nullptr != m_data ) {
+					::munmap( m_data, m_bytes );
+					m_data = nullptr;
+				}
+			}
+#endif
+		};	// class mapped_file
+
+		namespace impl {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Index storage that also keeps the mapping alive for as long
+			/// as any range uses it
+			template<typename value_type, typename Index>
+			struct mapped_storage: index_storage<value_type, value_type*, Index> {
+				std::shared_ptr<mapped_file<value_type>> file;
+
+				explicit mapped_storage( std::shared_ptr<mapped_file<value_type>> mapping ): index_storage<value_type, value_type*, Index>( mapping->data( ), mapping->data( ) + mapping->size( ) ), file( std::move( mapping ) ) { }
+			};	// struct mapped_storage
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Creates a FilteredRange over the records of a mapped file
+		/// without copying them.  Each record costs one Index; the values are
+		/// read from the mapping as they are used.  Ranges made from the same
+		/// mapping can be combined with the set operations
+		template<typename Index = uint32_t, typename value_type>
+		FilteredRange<value_type, impl::mapped_storage<value_type, Index>> create_mapped_range( std::shared_ptr<mapped_file<value_type>> file ) {
+			static_assert(std::is_unsigned<Index>::value, "Index must be an unsigned integral type");
+			auto const first = file->begin( );
+			auto const last = file->end( );
+			return FilteredRange<value_type, impl::mapped_storage<value_type, Index>>( impl::mapped_storage<value_type, Index>( std::move( file ) ), first, last );
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Maps the file at path and creates a FilteredRange over its
+		/// value_type records.  See create_mapped_range above
+		template<typename value_type, typename Index = uint32_t>
+		FilteredRange<value_type, impl::mapped_storage<value_type, Index>> create_mapped_range( const std::string& path, access_hint hint = access_hint::sequential ) {
+			return create_mapped_range<Index>( std::make_shared<mapped_file<value_type>>( path, hint ) );
+		}
+	}	// namespace range
+}	// namespace daw
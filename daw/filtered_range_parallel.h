@@ -0,0 +1,433 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace daw {
+	namespace range {
+		namespace execution {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Says how an operation may be run.  A thread_count of 1 runs
+			/// it on the calling thread, 0 uses every hardware thread.  Tasks run on
+			/// new std::threads unless an executor is given, e.g. a thread pool's
+			/// submit function.  Chunked operations hand out chunk_size values at a
+			/// time.
+			class policy {
+			public:
+				using executor_type = std::function<void( std::function<void( )> )>;
+
+				static const size_t default_chunk_size = 4096;
+
+				explicit policy( size_t thread_count = 0, executor_type executor = executor_type( ), size_t chunk_size = default_chunk_size ): m_thread_count( thread_count ), m_chunk_size( 0 == chunk_size ? 1 : chunk_size ), m_executor( std::move( executor ) ) { }
+
+				policy with_threads( size_t thread_count ) const {
+					return policy( thread_count, m_executor, m_chunk_size );
+				}
+
+				policy with_chunk_size( size_t chunk_size ) const {
+					return policy( m_thread_count, m_executor, chunk_size );
+				}
+
+				policy on( executor_type executor ) const {
+					return policy( m_thread_count, std::move( executor ), m_chunk_size );
+				}
+
+				size_t chunk_size( ) const {
+					return m_chunk_size;
+				}
+
+				size_t thread_count( ) const {
+					if( 0 != m_thread_count ) {
+						return m_thread_count;
+					}
+					auto const hardware = static_cast<size_t>(std::thread::hardware_concurrency( ));
+					return 0 == hardware ? 1 : hardware;
+				}
+
+				bool is_sequential( ) const {
+					return 1 == thread_count( );
+				}
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Calls func( n ) for every n in [0, task_count) and waits
+				/// for all of them.  The first exception thrown by a task is rethrown
+				template<typename Func>
+				void run_tasks( size_t task_count, Func func ) const {
+					if( task_count <= 1 || is_sequential( ) ) {
+						for( size_t n = 0; n < task_count; ++n ) {
+							func( n );
+						}
+						return;
+					}
+					std::mutex mut;
+					std::condition_variable cv;
+					size_t remaining = task_count - 1;
+					std::exception_ptr error;
+					auto run_one = [&]( size_t n ) {
+						try {
+							func( n );
+						} catch( ... ) {
+							std::lock_guard<std::mutex> lock( mut );
+							if( !error ) {
+								error = std::current_exception( );
+							}
+						}
+					};
+					auto task_done = [&]( ) {
+						std::lock_guard<std::mutex> lock( mut );
+						if( 0 == --remaining ) {
+							cv.notify_one( );
+						}
+					};
+					auto threads = std::vector<std::thread>( );
+					for( size_t n = 1; n < task_count; ++n ) {
+						auto task = [&run_one, &task_done, n]( ) {
+							run_one( n );
+							task_done( );
+						};
+						if( m_executor ) {
+							m_executor( task );
+						} else {
+							threads.emplace_back( task );
+						}
+					}
+					run_one( 0 );
+					{
+						std::unique_lock<std::mutex> lock( mut );
+						cv.wait( lock, [&remaining]( ) { return 0 == remaining; } );
+					}
+					for( auto& th : threads ) {
+						th.join( );
+					}
+					if( error ) {
+						std::rethrow_exception( error );
+					}
+				}
+
+			private:
+				size_t m_thread_count;
+				size_t m_chunk_size;
+				executor_type m_executor;
+			};	// class policy
+
+			static const policy seq( 1 );
+			static const policy par( 0 );
+			static const policy par_unseq( 0 );
+		}	// namespace execution
+
+		namespace impl {
+			// Below this many values per thread the parallel algorithms run serially
+			static const size_t parallel_min_chunk = 4096;
+
+			inline size_t parallel_parts( const execution::policy& policy, size_t count ) {
+				return std::max( size_t( 1 ), std::min( policy.thread_count( ), count / parallel_min_chunk ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Hands out chunk numbers to workers.  Each worker starts with
+			/// a contiguous block of chunks and, once it runs dry, steals the back
+			/// half of another worker's remaining block.
+			class chunk_scheduler {
+			public:
+				chunk_scheduler( size_t chunk_count, size_t worker_count ): m_workers( worker_count ) {
+					for( size_t n = 0; n < worker_count; ++n ) {
+						m_workers[n].first = n * chunk_count / worker_count;
+						m_workers[n].last = (n + 1) * chunk_count / worker_count;
+					}
+				}
+
+				size_t worker_count( ) const {
+					return m_workers.size( );
+				}
+
+				bool next( size_t worker, size_t& chunk ) {
+					auto& own = m_workers[worker];
+					{
+						std::lock_guard<std::mutex> lock( own.mut );
+						if( own.first < own.last ) {
+							chunk = own.first++;
+							return true;
+						}
+					}
+					for( size_t n = 1; n < m_workers.size( ); ++n ) {
+						auto& victim = m_workers[(worker + n) % m_workers.size( )];
+						size_t stolen_first;
+						size_t stolen_last;
+						{
+							std::lock_guard<std::mutex> lock( victim.mut );
+							if( victim.first >= victim.last ) {
+								continue;
+							}
+							stolen_first = victim.first + (victim.last - victim.first) / 2;
+							stolen_last = victim.last;
+							victim.last = stolen_first;
+						}
+						std::lock_guard<std::mutex> lock( own.mut );
+						own.first = stolen_first + 1;
+						own.last = stolen_last;
+						chunk = stolen_first;
+						return true;
+					}
+					return false;
+				}
+
+			private:
+				struct worker_range {
+					std::mutex mut;
+					size_t first;
+					size_t last;
+				};
+				std::vector<worker_range> m_workers;
+			};	// class chunk_scheduler
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Calls func( first, last ) for consecutive chunks of
+			/// [0, count), chunk_size positions at a time, on the threads of policy
+			template<typename Func>
+			void parallel_for_chunks( const execution::policy& policy, size_t count, Func func ) {
+				auto const chunk_size = policy.chunk_size( );
+				auto const chunk_count = (count + chunk_size - 1) / chunk_size;
+				auto const worker_count = std::min( policy.thread_count( ), chunk_count );
+				if( worker_count <= 1 ) {
+					if( 0 != count ) {
+						func( size_t( 0 ), count );
+					}
+					return;
+				}
+				auto scheduler = chunk_scheduler( chunk_count, worker_count );
+				policy.run_tasks( worker_count, [&]( size_t worker ) {
+					size_t chunk;
+					while( scheduler.next( worker, chunk ) ) {
+						func( chunk * chunk_size, std::min( count, (chunk + 1) * chunk_size ) );
+					}
+				} );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns the values for which pred is true in their original
+			/// order.  pred is evaluated in parallel chunks and the survivors of
+			/// each chunk are stitched together at their prefix offsets
+			template<typename T, typename Alloc, typename Predicate>
+			std::vector<T, Alloc> parallel_copy_if( const execution::policy& policy, const std::vector<T, Alloc>& values, Predicate pred ) {
+				auto const chunk_size = policy.chunk_size( );
+				auto const chunk_count = (values.size( ) + chunk_size - 1) / chunk_size;
+				auto keep = std::vector<char>( values.size( ) );
+				auto counts = std::vector<size_t>( chunk_count, 0 );
+				parallel_for_chunks( policy, values.size( ), [&]( size_t first, size_t last ) {
+					for( auto pos = first; pos < last; ++pos ) {
+						keep[pos] = pred( values[pos] ) ? 1 : 0;
+					}
+					// A serial run covers several chunks at once
+					for( auto chunk = first / chunk_size; chunk * chunk_size < last; ++chunk ) {
+						counts[chunk] = static_cast<size_t>(std::count( keep.begin( ) + static_cast<std::ptrdiff_t>(chunk * chunk_size), keep.begin( ) + static_cast<std::ptrdiff_t>(std::min( last, (chunk + 1) * chunk_size )), 1 ));
+					}
+				} );
+				auto offsets = std::vector<size_t>( chunk_count, 0 );
+				size_t total = 0;
+				for( size_t n = 0; n < chunk_count; ++n ) {
+					offsets[n] = total;
+					total += counts[n];
+				}
+				auto result = std::vector<T, Alloc>( values.begin( ), values.begin( ) + static_cast<std::ptrdiff_t>(total), values.get_allocator( ) );
+				parallel_for_chunks( policy, values.size( ), [&]( size_t first, size_t last ) {
+					auto out = offsets[first / chunk_size];
+					for( auto pos = first; pos < last; ++pos ) {
+						if( 0 != keep[pos] ) {
+							result[out++] = values[pos];
+						}
+					}
+				} );
+				return result;
+			}
+
+			template<typename RandomIter>
+			struct merge_task {
+				RandomIter a_first;
+				RandomIter a_last;
+				RandomIter b_first;
+				RandomIter b_last;
+				RandomIter out;
+			};
+
+			// Splits the stable merge of [a_first, a_last) and [b_first, b_last) into
+			// up to parts independent merges
+			template<typename RandomIter, typename Compare>
+			void split_merge( RandomIter a_first, RandomIter a_last, RandomIter b_first, RandomIter b_last, RandomIter out, size_t parts, Compare& comp, std::vector<merge_task<RandomIter>>& tasks ) {
+				auto const a_size = static_cast<size_t>(a_last - a_first);
+				auto const b_size = static_cast<size_t>(b_last - b_first);
+				auto prev_a = a_first;
+				auto prev_b = b_first;
+				for( size_t n = 1; n < parts; ++n ) {
+					RandomIter split_a;
+					RandomIter split_b;
+					if( a_size >= b_size ) {
+						split_a = a_first + static_cast<std::ptrdiff_t>(n * a_size / parts);
+						split_b = split_a == a_last ? b_last : std::lower_bound( b_first, b_last, *split_a, comp );
+					} else {
+						split_b = b_first + static_cast<std::ptrdiff_t>(n * b_size / parts);
+						split_a = split_b == b_last ? a_last : std::upper_bound( a_first, a_last, *split_b, comp );
+					}
+					split_a = std::max( split_a, prev_a );
+					split_b = std::max( split_b, prev_b );
+					tasks.push_back( merge_task<RandomIter>{ prev_a, split_a, prev_b, split_b, out + ((prev_a - a_first) + (prev_b - b_first)) } );
+					prev_a = split_a;
+					prev_b = split_b;
+				}
+				tasks.push_back( merge_task<RandomIter>{ prev_a, a_last, prev_b, b_last, out + ((prev_a - a_first) + (prev_b - b_first)) } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Stable merge sort.  Chunks are sorted in parallel and then
+			/// merged pairwise, each merge itself split across the threads.  The
+			/// result is identical to std::stable_sort
+			template<typename T, typename Alloc, typename Compare>
+			void parallel_stable_sort( const execution::policy& policy, std::vector<T, Alloc>& values, Compare comp ) {
+				auto const parts = parallel_parts( policy, values.size( ) );
+				if( parts <= 1 ) {
+					std::stable_sort( values.begin( ), values.end( ), comp );
+					return;
+				}
+				auto bounds = std::vector<size_t>( );
+				for( size_t n = 0; n <= parts; ++n ) {
+					bounds.push_back( n * values.size( ) / parts );
+				}
+				policy.run_tasks( parts, [&]( size_t n ) {
+					std::stable_sort( values.begin( ) + static_cast<std::ptrdiff_t>(bounds[n]), values.begin( ) + static_cast<std::ptrdiff_t>(bounds[n + 1]), comp );
+				} );
+
+				auto buffer = values;
+				auto* src = &values;
+				auto* dst = &buffer;
+				using iter_t = typename std::vector<T, Alloc>::iterator;
+				while( bounds.size( ) > 2 ) {
+					auto const runs = bounds.size( ) - 1;
+					auto const merges_per_run = std::max( size_t( 1 ), policy.thread_count( ) / (runs / 2) );
+					auto tasks = std::vector<merge_task<iter_t>>( );
+					auto new_bounds = std::vector<size_t>( 1, 0 );
+					for( size_t n = 0; n + 1 < runs; n += 2 ) {
+						auto const first = src->begin( );
+						split_merge( first + static_cast<std::ptrdiff_t>(bounds[n]), first + static_cast<std::ptrdiff_t>(bounds[n + 1]), first + static_cast<std::ptrdiff_t>(bounds[n + 1]), first + static_cast<std::ptrdiff_t>(bounds[n + 2]), dst->begin( ) + static_cast<std::ptrdiff_t>(bounds[n]), merges_per_run, comp, tasks );
+						new_bounds.push_back( bounds[n + 2] );
+					}
+					if( 1 == runs % 2 ) {
+						// The odd run out is carried over as an empty merge
+						auto const first = src->begin( );
+						tasks.push_back( merge_task<iter_t>{ first + static_cast<std::ptrdiff_t>(bounds[runs - 1]), first + static_cast<std::ptrdiff_t>(bounds[runs]), first, first, dst->begin( ) + static_cast<std::ptrdiff_t>(bounds[runs - 1]) } );
+						new_bounds.push_back( bounds[runs] );
+					}
+					policy.run_tasks( tasks.size( ), [&]( size_t n ) {
+						auto const & task = tasks[n];
+						std::merge( task.a_first, task.a_last, task.b_first, task.b_last, task.out, comp );
+					} );
+					std::swap( src, dst );
+					bounds = std::move( new_bounds );
+				}
+				if( src != &values ) {
+					values.swap( buffer );
+				}
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Moves the values for which pred is true in front of the
+			/// others keeping the relative order of both groups, like
+			/// std::stable_partition.  pred is evaluated once per value, in parallel
+			template<typename T, typename Alloc, typename Predicate>
+			void parallel_stable_partition( const execution::policy& policy, std::vector<T, Alloc>& values, Predicate pred ) {
+				auto const parts = parallel_parts( policy, values.size( ) );
+				if( parts <= 1 ) {
+					std::stable_partition( values.begin( ), values.end( ), pred );
+					return;
+				}
+				auto flags = std::vector<char>( values.size( ) );
+				auto true_counts = std::vector<size_t>( parts, 0 );
+				auto bound = [&]( size_t n ) { return n * values.size( ) / parts; };
+				policy.run_tasks( parts, [&]( size_t n ) {
+					size_t count = 0;
+					for( auto pos = bound( n ); pos < bound( n + 1 ); ++pos ) {
+						flags[pos] = pred( values[pos] ) ? 1 : 0;
+						count += static_cast<size_t>(flags[pos]);
+					}
+					true_counts[n] = count;
+				} );
+				auto true_offsets = std::vector<size_t>( parts, 0 );
+				auto false_offsets = std::vector<size_t>( parts, 0 );
+				size_t total_true = 0;
+				for( size_t n = 0; n < parts; ++n ) {
+					true_offsets[n] = total_true;
+					total_true += true_counts[n];
+				}
+				for( size_t n = 0; n < parts; ++n ) {
+					false_offsets[n] = total_true + (bound( n ) - true_offsets[n]);
+				}
+				auto buffer = values;
+				policy.run_tasks( parts, [&]( size_t n ) {
+					auto true_pos = true_offsets[n];
+					auto false_pos = false_offsets[n];
+					for( auto pos = bound( n ); pos < bound( n + 1 ); ++pos ) {
+						buffer[0 != flags[pos] ? true_pos++ : false_pos++] = values[pos];
+					}
+				} );
+				values.swap( buffer );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Keeps the first of each run of equal values, like std::unique
+			/// followed by erase when equal is an equivalence relation
+			template<typename T, typename Alloc, typename BinaryPredicate>
+			void parallel_unique( const execution::policy& policy, std::vector<T, Alloc>& values, BinaryPredicate equal ) {
+				auto const parts = parallel_parts( policy, values.size( ) );
+				if( parts <= 1 ) {
+					values.erase( std::unique( values.begin( ), values.end( ), equal ), values.end( ) );
+					return;
+				}
+				auto keep = std::vector<char>( values.size( ) );
+				auto counts = std::vector<size_t>( parts, 0 );
+				auto bound = [&]( size_t n ) { return n * values.size( ) / parts; };
+				policy.run_tasks( parts, [&]( size_t n ) {
+					size_t count = 0;
+					for( auto pos = bound( n ); pos < bound( n + 1 ); ++pos ) {
+						keep[pos] = (0 == pos || !equal( values[pos - 1], values[pos] )) ? 1 : 0;
+						count += static_cast<size_t>(keep[pos]);
+					}
+					counts[n] = count;
+				} );
+				auto offsets = std::vector<size_t>( parts, 0 );
+				size_t total = 0;
+				for( size_t n = 0; n < parts; ++n ) {
+					offsets[n] = total;
+					total += counts[n];
+				}
+				auto result = std::vector<T, Alloc>( values.begin( ), values.begin( ) + static_cast<std::ptrdiff_t>(total), values.get_allocator( ) );
+				policy.run_tasks( parts, [&]( size_t n ) {
+					auto out = offsets[n];
+					for( auto pos = bound( n ); pos < bound( n + 1 ); ++pos ) {
+						if( 0 != keep[pos] ) {
+							result[out++] = values[pos];
+						}
+					}
+				} );
+				values.swap( result );
+			}
+
+			template<typename T, typename Alloc>
+			void parallel_reverse( const execution::policy& policy, std::vector<T, Alloc>& values ) {
+				auto const half = values.size( ) / 2;
+				auto const parts = parallel_parts( policy, half );
+				auto const last = values.size( ) - 1;
+				policy.run_tasks( parts, [&]( size_t n ) {
+					for( auto pos = n * half / parts; pos < (n + 1) * half / parts; ++pos ) {
+						using std::swap;
+						swap( values[pos], values[last - pos] );
+					}
+				} );
+			}
+		}	// namespace impl
+	}	// namespace range
+}	// namespace daw
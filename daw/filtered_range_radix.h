@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Maps a value to an unsigned key whose unsigned order is the
+			/// value's operator< order, so it can be sorted one byte at a time
+			template<typename T, typename = void>
+			struct radix_key: std::false_type { };
+
+			template<typename T>
+			struct radix_key<T, typename std::enable_if<std::is_integral<T>::value && !std::is_const<T>::value && !std::is_same<T, bool>::value>::type>: std::true_type {
+				using key_type = typename std::make_unsigned<T>::type;
+
+				static key_type to_key( T value ) {
+					// Flipping the sign bit puts negative values before positive ones
+					return static_cast<key_type>(static_cast<key_type>(value) ^ (std::is_signed<T>::value ? static_cast<key_type>(key_type( 1 ) << (std::numeric_limits<key_type>::digits - 1)) : key_type( 0 )));
+				}
+			};
+
+			template<typename T, typename Bits>
+			struct radix_float_key: std::true_type {
+				using key_type = Bits;
+
+				static key_type to_key( T value ) {
+					// -0.0 and 0.0 are equivalent by operator< and must stay in order
+					if( value == T( 0 ) ) {
+						value = T( 0 );
+					}
+					key_type bits;
+					std::memcpy( &bits, &value, sizeof( bits ) );
+					auto const sign = static_cast<key_type>(key_type( 1 ) << (std::numeric_limits<key_type>::digits - 1));
+					// Negative values are ordered by decreasing magnitude
+					return 0 != (bits & sign) ? static_cast<key_type>(~bits) : static_cast<key_type>(bits | sign);
+				}
+			};
+
+			template<>
+			struct radix_key<float>: radix_float_key<float, uint32_t> {
+				static_assert(sizeof( float ) == sizeof( uint32_t ) && std::numeric_limits<float>::is_iec559, "radix sort requires IEEE 754 floats");
+			};
+
+			template<>
+			struct radix_key<double>: radix_float_key<double, uint64_t> {
+				static_assert(sizeof( double ) == sizeof( uint64_t ) && std::numeric_limits<double>::is_iec559, "radix sort requires IEEE 754 doubles");
+			};
+
+			// Which comparators a radix sort can stand in for
+			template<typename T, typename Compare>
+			struct radix_order: std::false_type {
+				static const bool descending = false;
+			};
+
+			template<typename T>
+			struct radix_order<T, std::less<T>>: radix_key<T> {
+				static const bool descending = false;
+			};
+
+			template<typename T>
+			struct radix_order<T, std::greater<T>>: radix_key<T> {
+				static const bool descending = true;
+			};
+
+			// Below this a comparison sort is as fast
+			static const size_t radix_min_size = 256;
+
+			template<typename Key, typename Index>
+			struct radix_item {
+				Key key;
+				Index index;
+			};
+
+			// LSD radix sort of (key, position) pairs, a byte per pass, then one
+			// pass to put the elements in order.  Each pass is a stable counting
+			// sort and passes where every key has the same byte are skipped
+			template<typename Key, typename Index, typename Element, typename Alloc, typename KeyOf>
+			void radix_sort_elements( std::vector<Element, Alloc>& elements, KeyOf key_of ) {
+				using item_vector = std::vector<radix_item<Key, Index>, typename std::allocator_traits<Alloc>::template rebind_alloc<radix_item<Key, Index>>>;
+				static const size_t digits = sizeof( Key );
+				static const size_t buckets = 256;
+				auto const count = elements.size( );
+				auto items = item_vector( count, radix_item<Key, Index>( ), elements.get_allocator( ) );
+				auto counts = std::vector<size_t>( digits * buckets, 0 );
+				for( size_t n = 0; n < count; ++n ) {
+					auto const key = key_of( elements[n] );
+					items[n].key = key;
+					items[n].index = static_cast<Index>(n);
+					for( size_t digit = 0; digit < digits; ++digit ) {
+						++counts[digit * buckets + ((key >> (digit * 8)) & 0xFF)];
+					}
+				}
+				auto buffer = item_vector( count, radix_item<Key, Index>( ), elements.get_allocator( ) );
+				for( size_t digit = 0; digit < digits; ++digit ) {
+					auto const offsets = &counts[digit * buckets];
+					auto const shift = digit * 8;
+					if( count == offsets[(items.front( ).key >> shift) & 0xFF] ) {
+						continue;
+					}
+					size_t total = 0;
+					for( size_t bucket = 0; bucket < buckets; ++bucket ) {
+						auto const bucket_count = offsets[bucket];
+						offsets[bucket] = total;
+						total += bucket_count;
+					}
+					for( auto& item : items ) {
+						buffer[offsets[(item.key >> shift) & 0xFF]++] = item;
+					}
+					items.swap( buffer );
+				}
+				auto sorted = std::vector<Element, Alloc>( elements.get_allocator( ) );
+				sorted.reserve( count );
+				for( auto& item : items ) {
+					sorted.push_back( elements[item.index] );
+				}
+				elements.swap( sorted );
+			}
+
+			template<typename value_type, typename Compare, typename Element, typename Alloc, typename Storage>
+			bool radix_sort_impl( std::vector<Element, Alloc>& elements, const Storage& storage, std::true_type ) {
+				using order = radix_order<value_type, Compare>;
+				using key_type = typename order::key_type;
+				if( elements.size( ) < radix_min_size ) {
+					return false;
+				}
+				auto key_of = [&storage]( const Element& element ) {
+					auto const key = order::to_key( storage.deref( element ) );
+					return order::descending ? static_cast<key_type>(~key) : key;
+				};
+				if( elements.size( ) <= static_cast<size_t>(std::numeric_limits<uint32_t>::max( )) ) {
+					radix_sort_elements<key_type, uint32_t>( elements, key_of );
+				} else {
+					radix_sort_elements<key_type, size_t>( elements, key_of );
+				}
+				return true;
+			}
+
+			template<typename value_type, typename Compare, typename Element, typename Alloc, typename Storage>
+			bool radix_sort_impl( std::vector<Element, Alloc>&, const Storage&, std::false_type ) {
+				return false;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Stably sorts the elements by their values with a radix sort
+			/// when comp is std::less or std::greater of an integral or floating
+			/// point value_type and there are enough of them.  Returns false,
+			/// leaving the elements alone, when a comparison sort should be used
+			template<typename value_type, typename Compare, typename Element, typename Alloc, typename Storage>
+			bool radix_sort( std::vector<Element, Alloc>& elements, const Storage& storage, const Compare& ) {
+				return radix_sort_impl<value_type, Compare>( elements, storage, std::integral_constant<bool, radix_order<value_type, Compare>::value>( ) );
+			}
+		}	// namespace impl
+	}	// namespace range
+}	// namespace daw
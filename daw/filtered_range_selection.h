@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "filtered_range_class.h"
+#include "filtered_range_simd.h"
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			// value must not be 0
+			inline size_t count_trailing_zeros( uint64_t value ) {
+#if defined( _MSC_VER ) && defined( _M_X64 )
+				unsigned long result;
+				_BitScanForward64( &result, value );
+				return static_cast<size_t>(result);
+#elif defined( _MSC_VER )
+				// 32-bit targets only have the 32-bit bit scan
+				unsigned long result;
+				if( _BitScanForward( &result, static_cast<unsigned long>(value) ) ) {
+					return static_cast<size_t>(result);
+				}
+				_BitScanForward( &result, static_cast<unsigned long>(value >> 32) );
+				return static_cast<size_t>(result) + 32;
+#else
+				return static_cast<size_t>(__builtin_ctzll( value ));
+#endif
+			}
+
+			inline size_t pop_count( uint64_t value ) {
+#ifdef _MSC_VER
+				// __popcnt64 needs the POPCNT instruction and is missing on 32-bit
+				// targets, so count with shifts and masks instead
+				value = value - ((value >> 1) & UINT64_C( 0x5555555555555555 ));
+				value = (value & UINT64_C( 0x3333333333333333 )) + ((value >> 2) & UINT64_C( 0x3333333333333333 ));
+				value = (value + (value >> 4)) & UINT64_C( 0x0F0F0F0F0F0F0F0F );
+				return static_cast<size_t>((value * UINT64_C( 0x0101010101010101 )) >> 56);
+#else
+				return static_cast<size_t>(__builtin_popcountll( value ));
+#endif
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: One bit per source position, set when the position is selected
+			class selection_bitmap {
+			public:
+				selection_bitmap( ): m_size( 0 ), m_words( ) { }
+
+				explicit selection_bitmap( size_t size ): m_size( size ), m_words( word_count( size ), 0 ) { }
+
+				size_t size( ) const {
+					return m_size;
+				}
+
+				size_t count( ) const {
+					size_t result = 0;
+					for( auto word : m_words ) {
+						result += pop_count( word );
+					}
+					return result;
+				}
+
+				uint64_t* data( ) {
+					return m_words.data( );
+				}
+
+				void set( size_t pos ) {
+					m_words[pos / 64] |= uint64_t( 1 ) << (pos % 64);
+				}
+
+				void set_all( ) {
+					std::fill( m_words.begin( ), m_words.end( ), ~uint64_t( 0 ) );
+					if( 0 != m_size % 64 ) {
+						m_words.back( ) = (uint64_t( 1 ) << (m_size % 64)) - 1;
+					}
+				}
+
+				selection_bitmap& operator&=(const selection_bitmap& rhs) {
+					for( size_t n = 0; n < m_words.size( ); ++n ) {
+						m_words[n] &= rhs.m_words[n];
+					}
+					return *this;
+				}
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Calls func( pos ) for each set position in ascending order.
+				/// Words without set bits are skipped whole.  Stops and returns false
+				/// when func returns false
+				template<typename Func>
+				bool for_each_set( Func func ) const {
+					for( size_t n = 0; n < m_words.size( ); ++n ) {
+						auto bits = m_words[n];
+						while( 0 != bits ) {
+							if( !func( n * 64 + count_trailing_zeros( bits ) ) ) {
+								return false;
+							}
+							bits &= bits - 1;
+						}
+					}
+					return true;
+				}
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Clears every set position for which pred( pos ) is false
+				template<typename Predicate>
+				void keep_if( Predicate pred ) {
+					for( size_t n = 0; n < m_words.size( ); ++n ) {
+						auto bits = m_words[n];
+						auto kept = bits;
+						while( 0 != bits ) {
+							auto const bit = count_trailing_zeros( bits );
+							if( !pred( n * 64 + bit ) ) {
+								kept &= ~(uint64_t( 1 ) << bit);
+							}
+							bits &= bits - 1;
+						}
+						m_words[n] = kept;
+					}
+				}
+
+			private:
+				size_t m_size;
+				std::vector<uint64_t> m_words;
+
+				static size_t word_count( size_t size ) {
+					return (size + 63) / 64;
+				}
+			};	// class selection_bitmap
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: A range whose filtered state is a bitmap over the positions of
+		/// the source references.  The references are shared with the FilteredRange
+		/// it was made from; each selection only adds one bit per element.  where
+		/// ANDs into the bitmap and clear_where restores the full set.  When the
+		/// references point to contiguous int32_t or float values the built in 
+		/// comparison predicates are evaluated with vector instructions.
+		template<typename value_type>
+		class SelectedRange {
+		public:
+			explicit SelectedRange( const FilteredRange<value_type>& range ): m_value_refs( range.m_value_refs ), m_selection( range.m_value_refs.get( ).size( ) ), m_contiguous( find_contiguous( impl::simd::is_simd_type<value_type>( ) ) ) {
+				auto const & values = m_value_refs.get( );
+				if( range.m_pred_include.get( ).empty( ) ) {
+					m_selection.set_all( );
+					return;
+				}
+				for( size_t n = 0; n < values.size( ); ++n ) {
+					if( range.value_included( values[n] ) ) {
+						m_selection.set( n );
+					}
+				}
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Deselects the values for which predicate is false.  Only
+			/// the currently selected values are tested
+			template<typename Predicate>
+			SelectedRange where( Predicate predicate ) const {
+				return where_impl( predicate, has_kernel<Predicate>( ) );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Keeps only the values selected in both ranges.  Both must
+			/// have been made from the same FilteredRange
+			SelectedRange where( const SelectedRange& other ) const {
+				if( !m_value_refs.shares_with( other.m_value_refs ) ) {
+					throw std::invalid_argument( "SelectedRange::where requires selections over the same source" );
+				}
+				auto result = *this;
+				result.m_selection &= other.m_selection;
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Selects every value of the source again
+			SelectedRange clear_where( ) const {
+				auto result = *this;
+				result.m_selection.set_all( );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: On every selected element do something
+			template<typename Func>
+			SelectedRange for_each( Func func ) const {
+				auto const & values = m_value_refs.get( );
+				m_selection.for_each_set( [&values, &func]( size_t pos ) {
+					func( values[pos].get( ) );
+					return true;
+				} );
+				return *this;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Copy all selected values to a std::vector
+			std::vector<value_type> to_vector( ) const {
+				auto result = std::vector<value_type>( );
+				result.reserve( size( ) );
+				for_each( [&result]( const value_type& value ) { result.push_back( value ); } );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Copy all selected values to the provided range up to the
+			/// smallest list.
+			template<typename Iter>
+			SelectedRange copy_to( Iter first_inclusive, Iter last_exclusive ) const {
+				auto const & values = m_value_refs.get( );
+				auto out_it = first_inclusive;
+				m_selection.for_each_set( [&]( size_t pos ) {
+					if( out_it == last_exclusive ) {
+						return false;
+					}
+					*out_it++ = values[pos].get( );
+					return true;
+				} );
+				return *this;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if value is selected
+			template<typename EqualToCompare = std::equal_to<value_type>>
+			bool contains( const value_type& value, EqualToCompare comp = EqualToCompare( ) ) const {
+				auto const & values = m_value_refs.get( );
+				return !m_selection.for_each_set( [&]( size_t pos ) { return !comp( value, values[pos].get( ) ); } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of selected values
+			size_t size( ) const {
+				return m_selection.count( );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Returns a boolean indicating if no values are selected
+			bool empty( ) const {
+				return m_selection.for_each_set( []( size_t ) { return false; } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Compacts the selected values into a FilteredRange
+			FilteredRange<value_type> to_filtered_range( ) const {
+				auto const & values = m_value_refs.get( );
+				auto result = typename FilteredRange<value_type>::element_vector( values.get_allocator( ) );
+				result.reserve( size( ) );
+				m_selection.for_each_set( [&values, &result]( size_t pos ) {
+					result.push_back( values[pos] );
+					return true;
+				} );
+				return FilteredRange<value_type>( std::move( result ), { } );
+			}
+
+		private:
+			impl::shared_vector<std::reference_wrapper<value_type>, resource_allocator<std::reference_wrapper<value_type>>> m_value_refs;
+			impl::selection_bitmap m_selection;
+			const value_type* m_contiguous;
+
+			template<typename Predicate, typename = void>
+			struct has_kernel: std::false_type { };
+
+			template<typename Predicate>
+			struct has_kernel<Predicate, typename std::enable_if<impl::simd::kernel_traits<Predicate>::value>::type>: std::is_same<typename impl::simd::kernel_traits<Predicate>::value_type, value_type> { };
+
+			// Address of the first value when the references cover one array in order
+			const value_type* find_contiguous( std::true_type ) const {
+				auto const & values = m_value_refs.get( );
+				if( values.empty( ) ) {
+					return nullptr;
+				}
+				auto const first = &values.front( ).get( );
+				for( size_t n = 1; n < values.size( ); ++n ) {
+					if( &values[n].get( ) != first + n ) {
+						return nullptr;
+					}
+				}
+				return first;
+			}
+
+			const value_type* find_contiguous( std::false_type ) const {
+				return nullptr;
+			}
+
+			template<typename Predicate>
+			SelectedRange where_impl( const Predicate& predicate, std::true_type ) const {
+				if( nullptr == m_contiguous ) {
+					return where_impl( predicate, std::false_type( ) );
+				}
+				auto mask = impl::selection_bitmap( m_selection.size( ) );
+				impl::simd::evaluate( impl::simd::best_level( ), predicate, m_contiguous, m_selection.size( ), mask.data( ) );
+				auto result = *this;
+				result.m_selection &= mask;
+				return result;
+			}
+
+			template<typename Predicate>
+			SelectedRange where_impl( const Predicate& predicate, std::false_type ) const {
+				auto result = *this;
+				auto const & values = m_value_refs.get( );
+				result.m_selection.keep_if( [&values, &predicate]( size_t pos ) { return predicate( values[pos].get( ) ); } );
+				return result;
+			}
+		};	// class SelectedRange
+
+		template<typename Container>
+		auto create_selected_range( Container& container ) -> SelectedRange < typename std::iterator_traits<decltype(std::begin( container ))>::value_type > {
+			return SelectedRange<typename std::iterator_traits<decltype(std::begin( container ))>::value_type>( create_filtered_range( container ) );
+		}
+	}	// namespace range
+}	// namespace daw
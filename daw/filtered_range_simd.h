@@ -0,0 +1,460 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "filtered_range_funcs.h"
+
+// Vectorized evaluation of the built in comparison predicates over contiguous
+// int32_t and float values.  The instruction set is chosen at runtime; define
+// DAW_RANGE_NO_SIMD to always use the scalar loop.
+#if !defined( DAW_RANGE_NO_SIMD ) && (defined( __x86_64__ ) || defined( _M_X64 ) || (defined( __i386__ ) && defined( __SSE2__ )) || (defined( _M_IX86_FP ) && _M_IX86_FP >= 2))
+#define DAW_RANGE_HAS_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DAW_RANGE_TARGET_AVX2
+#define DAW_RANGE_TARGET_AVX512
+#else
+#define DAW_RANGE_TARGET_AVX2 __attribute__((target("avx2")))
+#define DAW_RANGE_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+// The AVX-512 intrinsics arrived in Visual Studio 2017
+#if !defined( _MSC_VER ) || _MSC_VER >= 1910
+#define DAW_RANGE_HAS_AVX512
+#endif
+#endif
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			namespace simd {
+				enum class level { scalar, sse2, avx2, avx512 };
+
+				enum class op { less, less_equal, greater, greater_equal, equal, not_equal, even, odd, in_span };
+
+				template<typename T>
+				struct is_simd_type: std::integral_constant<bool, std::is_same<T, int32_t>::value || std::is_same<T, float>::value> { };
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Maps a predicate object to a kernel.  value is true when
+				/// the predicate can be evaluated by evaluate( )
+				template<typename Predicate>
+				struct kernel_traits: std::false_type { };
+
+				template<typename Compare>
+				struct compare_op: std::false_type { };
+
+				template<typename T>
+				struct compare_op<std::less<T>>: std::true_type { static const op code = op::less; };
+
+				template<typename T>
+				struct compare_op<std::less_equal<T>>: std::true_type { static const op code = op::less_equal; };
+
+				template<typename T>
+				struct compare_op<std::greater<T>>: std::true_type { static const op code = op::greater; };
+
+				template<typename T>
+				struct compare_op<std::greater_equal<T>>: std::true_type { static const op code = op::greater_equal; };
+
+				template<typename T>
+				struct compare_op<std::equal_to<T>>: std::true_type { static const op code = op::equal; };
+
+				template<typename T>
+				struct compare_op<std::not_equal_to<T>>: std::true_type { static const op code = op::not_equal; };
+
+				template<typename T, typename Compare>
+				struct kernel_traits<compare_to<T, Compare>>: std::integral_constant<bool, is_simd_type<T>::value && compare_op<Compare>::value> {
+					using value_type = T;
+					static bool matches_nothing( const compare_to<T, Compare>& ) {
+						return false;
+					}
+					static op code( ) {
+						return compare_op<Compare>::code;
+					}
+					static T first( const compare_to<T, Compare>& pred ) {
+						return pred.value;
+					}
+					static T second( const compare_to<T, Compare>& ) {
+						return T( );
+					}
+				};
+
+				template<>
+				struct kernel_traits<even_pred<int32_t>>: std::true_type {
+					using value_type = int32_t;
+					static bool matches_nothing( const even_pred<int32_t>& ) {
+						return false;
+					}
+					static op code( ) {
+						return op::even;
+					}
+					static int32_t first( const even_pred<int32_t>& ) {
+						return 0;
+					}
+					static int32_t second( const even_pred<int32_t>& ) {
+						return 0;
+					}
+				};
+
+				template<>
+				struct kernel_traits<odd_pred<int32_t>>: std::true_type {
+					using value_type = int32_t;
+					static bool matches_nothing( const odd_pred<int32_t>& ) {
+						return false;
+					}
+					static op code( ) {
+						return op::odd;
+					}
+					static int32_t first( const odd_pred<int32_t>& ) {
+						return 0;
+					}
+					static int32_t second( const odd_pred<int32_t>& ) {
+						return 0;
+					}
+				};
+
+				template<bool LoInclusive, bool HiInclusive>
+				struct kernel_traits<in_range<int32_t, LoInclusive, HiInclusive, true>>: std::true_type {
+					using value_type = int32_t;
+					static bool matches_nothing( const in_range<int32_t, LoInclusive, HiInclusive, true>& pred ) {
+						return pred.is_empty;
+					}
+					static op code( ) {
+						return op::in_span;
+					}
+					static int32_t first( const in_range<int32_t, LoInclusive, HiInclusive, true>& pred ) {
+						return static_cast<int32_t>(pred.first);
+					}
+					static int32_t second( const in_range<int32_t, LoInclusive, HiInclusive, true>& pred ) {
+						return static_cast<int32_t>(pred.span);
+					}
+				};
+
+				template<typename T>
+				inline bool scalar_test( op code, T value, T a, T b ) {
+					switch( code ) {
+					case op::less: return value < a;
+					case op::less_equal: return value <= a;
+					case op::greater: return value > a;
+					case op::greater_equal: return value >= a;
+					case op::equal: return value == a;
+					case op::not_equal: return value != a;
+					case op::even: return 0 == static_cast<int64_t>(value) % 2;
+					case op::odd: return 0 != static_cast<int64_t>(value) % 2;
+					case op::in_span: return static_cast<uint32_t>(static_cast<uint32_t>(value) - static_cast<uint32_t>(a)) <= static_cast<uint32_t>(b);
+					}
+					return false;
+				}
+
+				template<typename T>
+				inline void evaluate_scalar( op code, const T* values, size_t first_pos, size_t count, T a, T b, uint64_t* words ) {
+					for( size_t n = first_pos; n < count; ++n ) {
+						if( scalar_test( code, values[n], a, b ) ) {
+							words[n / 64] |= uint64_t( 1 ) << (n % 64);
+						}
+					}
+				}
+
+#ifdef DAW_RANGE_HAS_X86_SIMD
+				inline bool cpu_has_avx2( ) {
+#ifdef _MSC_VER
+					int info[4];
+					__cpuid( info, 1 );
+					bool const os_avx = 0 != (info[2] & (1 << 27)) && 0x6 == (_xgetbv( 0 ) & 0x6);
+					__cpuidex( info, 7, 0 );
+					return os_avx && 0 != (info[1] & (1 << 5));
+#else
+					return 0 != __builtin_cpu_supports( "avx2" );
+#endif
+				}
+
+#ifdef DAW_RANGE_HAS_AVX512
+				inline bool cpu_has_avx512( ) {
+#ifdef _MSC_VER
+					int info[4];
+					__cpuid( info, 1 );
+					bool const os_avx512 = 0 != (info[2] & (1 << 27)) && 0xE6 == (_xgetbv( 0 ) & 0xE6);
+					__cpuidex( info, 7, 0 );
+					return os_avx512 && 0 != (info[1] & (1 << 16));
+#else
+					return 0 != __builtin_cpu_supports( "avx512f" );
+#endif
+				}
+#endif	// DAW_RANGE_HAS_AVX512
+
+				// SSE2: 4 lanes
+				template<op Code>
+				inline __m128i cmp_sse2( __m128i x, __m128i a, __m128i b ) {
+					auto const ones = _mm_set1_epi32( -1 );
+					switch( Code ) {
+					case op::less: return _mm_cmplt_epi32( x, a );
+					case op::less_equal: return _mm_xor_si128( _mm_cmpgt_epi32( x, a ), ones );
+					case op::greater: return _mm_cmpgt_epi32( x, a );
+					case op::greater_equal: return _mm_xor_si128( _mm_cmplt_epi32( x, a ), ones );
+					case op::equal: return _mm_cmpeq_epi32( x, a );
+					case op::not_equal: return _mm_xor_si128( _mm_cmpeq_epi32( x, a ), ones );
+					case op::even: return _mm_cmpeq_epi32( _mm_and_si128( x, _mm_set1_epi32( 1 ) ), _mm_setzero_si128( ) );
+					case op::odd: return _mm_xor_si128( _mm_cmpeq_epi32( _mm_and_si128( x, _mm_set1_epi32( 1 ) ), _mm_setzero_si128( ) ), ones );
+					case op::in_span: {
+						// Unsigned compare via the sign flip
+						auto const sign = _mm_set1_epi32( INT32_MIN );
+						auto const offset = _mm_xor_si128( _mm_sub_epi32( x, a ), sign );
+						return _mm_xor_si128( _mm_cmpgt_epi32( offset, _mm_xor_si128( b, sign ) ), ones );
+					}
+					}
+					return _mm_setzero_si128( );
+				}
+
+				template<op Code>
+				inline __m128 cmp_sse2( __m128 x, __m128 a, __m128 ) {
+					switch( Code ) {
+					case op::less: return _mm_cmplt_ps( x, a );
+					case op::less_equal: return _mm_cmple_ps( x, a );
+					case op::greater: return _mm_cmpgt_ps( x, a );
+					case op::greater_equal: return _mm_cmpge_ps( x, a );
+					case op::equal: return _mm_cmpeq_ps( x, a );
+					case op::not_equal: return _mm_cmpneq_ps( x, a );
+					default: return _mm_setzero_ps( );
+					}
+				}
+
+				template<op Code>
+				inline uint64_t block_sse2( const int32_t* values, int32_t a, int32_t b ) {
+					auto const va = _mm_set1_epi32( a );
+					auto const vb = _mm_set1_epi32( b );
+					uint64_t result = 0;
+					for( size_t n = 0; n < 64; n += 4 ) {
+						auto const mask = cmp_sse2<Code>( _mm_loadu_si128( reinterpret_cast<const __m128i*>(values + n) ), va, vb );
+						result |= static_cast<uint64_t>(_mm_movemask_ps( _mm_castsi128_ps( mask ) )) << n;
+					}
+					return result;
+				}
+
+				template<op Code>
+				inline uint64_t block_sse2( const float* values, float a, float b ) {
+					auto const va = _mm_set1_ps( a );
+					auto const vb = _mm_set1_ps( b );
+					uint64_t result = 0;
+					for( size_t n = 0; n < 64; n += 4 ) {
+						result |= static_cast<uint64_t>(_mm_movemask_ps( cmp_sse2<Code>( _mm_loadu_ps( values + n ), va, vb ) )) << n;
+					}
+					return result;
+				}
+
+				// AVX2: 8 lanes
+				template<op Code>
+				DAW_RANGE_TARGET_AVX2 inline __m256i cmp_avx2( __m256i x, __m256i a, __m256i b ) {
+					auto const ones = _mm256_set1_epi32( -1 );
+					switch( Code ) {
+					case op::less: return _mm256_cmpgt_epi32( a, x );
+					case op::less_equal: return _mm256_xor_si256( _mm256_cmpgt_epi32( x, a ), ones );
+					case op::greater: return _mm256_cmpgt_epi32( x, a );
+					case op::greater_equal: return _mm256_xor_si256( _mm256_cmpgt_epi32( a, x ), ones );
+					case op::equal: return _mm256_cmpeq_epi32( x, a );
+					case op::not_equal: return _mm256_xor_si256( _mm256_cmpeq_epi32( x, a ), ones );
+					case op::even: return _mm256_cmpeq_epi32( _mm256_and_si256( x, _mm256_set1_epi32( 1 ) ), _mm256_setzero_si256( ) );
+					case op::odd: return _mm256_xor_si256( _mm256_cmpeq_epi32( _mm256_and_si256( x, _mm256_set1_epi32( 1 ) ), _mm256_setzero_si256( ) ), ones );
+					case op::in_span: {
+						auto const sign = _mm256_set1_epi32( INT32_MIN );
+						auto const offset = _mm256_xor_si256( _mm256_sub_epi32( x, a ), sign );
+						return _mm256_xor_si256( _mm256_cmpgt_epi32( offset, _mm256_xor_si256( b, sign ) ), ones );
+					}
+					}
+					return _mm256_setzero_si256( );
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX2 inline __m256 cmp_avx2( __m256 x, __m256 a, __m256 ) {
+					switch( Code ) {
+					case op::less: return _mm256_cmp_ps( x, a, _CMP_LT_OQ );
+					case op::less_equal: return _mm256_cmp_ps( x, a, _CMP_LE_OQ );
+					case op::greater: return _mm256_cmp_ps( x, a, _CMP_GT_OQ );
+					case op::greater_equal: return _mm256_cmp_ps( x, a, _CMP_GE_OQ );
+					case op::equal: return _mm256_cmp_ps( x, a, _CMP_EQ_OQ );
+					case op::not_equal: return _mm256_cmp_ps( x, a, _CMP_NEQ_UQ );
+					default: return _mm256_setzero_ps( );
+					}
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX2 inline void run_avx2( const int32_t* values, size_t word_count, int32_t a, int32_t b, uint64_t* words ) {
+					auto const va = _mm256_set1_epi32( a );
+					auto const vb = _mm256_set1_epi32( b );
+					for( size_t w = 0; w < word_count; ++w ) {
+						uint64_t result = 0;
+						for( size_t n = 0; n < 64; n += 8 ) {
+							auto const mask = cmp_avx2<Code>( _mm256_loadu_si256( reinterpret_cast<const __m256i*>(values + w * 64 + n) ), va, vb );
+							result |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_ps( _mm256_castsi256_ps( mask ) ))) << n;
+						}
+						words[w] = result;
+					}
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX2 inline void run_avx2( const float* values, size_t word_count, float a, float b, uint64_t* words ) {
+					auto const va = _mm256_set1_ps( a );
+					auto const vb = _mm256_set1_ps( b );
+					for( size_t w = 0; w < word_count; ++w ) {
+						uint64_t result = 0;
+						for( size_t n = 0; n < 64; n += 8 ) {
+							result |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_ps( cmp_avx2<Code>( _mm256_loadu_ps( values + w * 64 + n ), va, vb ) ))) << n;
+						}
+						words[w] = result;
+					}
+				}
+
+#ifdef DAW_RANGE_HAS_AVX512
+				// AVX-512: 16 lanes, the compares produce the bit mask directly
+				template<op Code>
+				DAW_RANGE_TARGET_AVX512 inline __mmask16 cmp_avx512( __m512i x, __m512i a, __m512i b ) {
+					switch( Code ) {
+					case op::less: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_LT );
+					case op::less_equal: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_LE );
+					case op::greater: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_NLE );
+					case op::greater_equal: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_NLT );
+					case op::equal: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_EQ );
+					case op::not_equal: return _mm512_cmp_epi32_mask( x, a, _MM_CMPINT_NE );
+					case op::even: return static_cast<__mmask16>(~_mm512_test_epi32_mask( x, _mm512_set1_epi32( 1 ) ));
+					case op::odd: return _mm512_test_epi32_mask( x, _mm512_set1_epi32( 1 ) );
+					case op::in_span: return _mm512_cmp_epu32_mask( _mm512_sub_epi32( x, a ), b, _MM_CMPINT_LE );
+					}
+					return 0;
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX512 inline __mmask16 cmp_avx512( __m512 x, __m512 a, __m512 ) {
+					switch( Code ) {
+					case op::less: return _mm512_cmp_ps_mask( x, a, _CMP_LT_OQ );
+					case op::less_equal: return _mm512_cmp_ps_mask( x, a, _CMP_LE_OQ );
+					case op::greater: return _mm512_cmp_ps_mask( x, a, _CMP_GT_OQ );
+					case op::greater_equal: return _mm512_cmp_ps_mask( x, a, _CMP_GE_OQ );
+					case op::equal: return _mm512_cmp_ps_mask( x, a, _CMP_EQ_OQ );
+					case op::not_equal: return _mm512_cmp_ps_mask( x, a, _CMP_NEQ_UQ );
+					default: return 0;
+					}
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX512 inline void run_avx512( const int32_t* values, size_t word_count, int32_t a, int32_t b, uint64_t* words ) {
+					auto const va = _mm512_set1_epi32( a );
+					auto const vb = _mm512_set1_epi32( b );
+					for( size_t w = 0; w < word_count; ++w ) {
+						uint64_t result = 0;
+						for( size_t n = 0; n < 64; n += 16 ) {
+							result |= static_cast<uint64_t>(cmp_avx512<Code>( _mm512_loadu_si512( values + w * 64 + n ), va, vb )) << n;
+						}
+						words[w] = result;
+					}
+				}
+
+				template<op Code>
+				DAW_RANGE_TARGET_AVX512 inline void run_avx512( const float* values, size_t word_count, float a, float b, uint64_t* words ) {
+					auto const va = _mm512_set1_ps( a );
+					auto const vb = _mm512_set1_ps( b );
+					for( size_t w = 0; w < word_count; ++w ) {
+						uint64_t result = 0;
+						for( size_t n = 0; n < 64; n += 16 ) {
+							result |= static_cast<uint64_t>(cmp_avx512<Code>( _mm512_loadu_ps( values + w * 64 + n ), va, vb )) << n;
+						}
+						words[w] = result;
+					}
+				}
+#endif	// DAW_RANGE_HAS_AVX512
+
+				inline level detect_level( ) {
+#ifdef DAW_RANGE_HAS_AVX512
+					if( cpu_has_avx512( ) ) {
+						return level::avx512;
+					}
+#endif
+					return cpu_has_avx2( ) ? level::avx2 : level::sse2;
+				}
+
+				// Detected once while the program starts instead of in a function local
+				// static, whose initialization is not thread safe before Visual Studio
+				// 2015.  Until then it reads as level::scalar, which is always usable
+				template<typename Unused = void>
+				struct detected_level {
+					static level const value;
+				};
+
+				template<typename Unused>
+				level const detected_level<Unused>::value = detect_level( );
+#endif	// DAW_RANGE_HAS_X86_SIMD
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: The widest instruction set usable on this machine
+				inline level best_level( ) {
+#ifdef DAW_RANGE_HAS_X86_SIMD
+					return detected_level<>::value;
+#else
+					return level::scalar;
+#endif
+				}
+
+#ifdef DAW_RANGE_HAS_X86_SIMD
+				template<op Code, typename T>
+				void run_level( level use_level, const T* values, size_t full_words, T a, T b, uint64_t* words ) {
+					switch( use_level ) {
+					case level::avx512:
+#ifdef DAW_RANGE_HAS_AVX512
+						run_avx512<Code>( values, full_words, a, b, words );
+						break;
+#endif
+					case level::avx2:
+						run_avx2<Code>( values, full_words, a, b, words );
+						break;
+					case level::sse2:
+						for( size_t w = 0; w < full_words; ++w ) {
+							words[w] = block_sse2<Code>( values + w * 64, a, b );
+						}
+						break;
+					case level::scalar:
+						evaluate_scalar( Code, values, 0, full_words * 64, a, b, words );
+						break;
+					}
+				}
+#endif	// DAW_RANGE_HAS_X86_SIMD
+
+				//////////////////////////////////////////////////////////////////////////
+				/// Summary: Sets bit n of words when code holds for values[n].  words
+				/// must hold ( count + 63 ) / 64 zeroed entries.  use_level must not be
+				/// wider than best_level( )
+				template<typename T>
+				void evaluate( level use_level, op code, const T* values, size_t count, T a, T b, uint64_t* words ) {
+					static_assert(is_simd_type<T>::value, "Only int32_t and float have vector kernels");
+					size_t const full_words = count / 64;
+#ifdef DAW_RANGE_HAS_X86_SIMD
+					switch( code ) {
+					case op::less: run_level<op::less>( use_level, values, full_words, a, b, words ); break;
+					case op::less_equal: run_level<op::less_equal>( use_level, values, full_words, a, b, words ); break;
+					case op::greater: run_level<op::greater>( use_level, values, full_words, a, b, words ); break;
+					case op::greater_equal: run_level<op::greater_equal>( use_level, values, full_words, a, b, words ); break;
+					case op::equal: run_level<op::equal>( use_level, values, full_words, a, b, words ); break;
+					case op::not_equal: run_level<op::not_equal>( use_level, values, full_words, a, b, words ); break;
+					case op::even: run_level<op::even>( use_level, values, full_words, a, b, words ); break;
+					case op::odd: run_level<op::odd>( use_level, values, full_words, a, b, words ); break;
+					case op::in_span: run_level<op::in_span>( use_level, values, full_words, a, b, words ); break;
+					}
+#else
+					(void)use_level;
+					evaluate_scalar( code, values, 0, full_words * 64, a, b, words );
+#endif
+					evaluate_scalar( code, values, full_words * 64, count, a, b, words );
+				}
+
+				template<typename Predicate, typename T>
+				void evaluate( level use_level, const Predicate& pred, const T* values, size_t count, uint64_t* words ) {
+					using traits = kernel_traits<Predicate>;
+					if( traits::matches_nothing( pred ) ) {
+						return;
+					}
+					evaluate( use_level, traits::code( ), values, count, traits::first( pred ), traits::second( pred ), words );
+				}
+			}	// namespace simd
+		}	// namespace impl
+	}	// namespace range
+}	// namespace daw
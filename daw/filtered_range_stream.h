@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace daw {
+	namespace range {
+		namespace impl {
+			// Adapts an input iterator pair to a generator
+			template<typename value_type, typename InputIter>
+			struct iterator_generator {
+				InputIter first;
+				InputIter last;
+
+				iterator_generator( InputIter first_inclusive, InputIter last_exclusive ): first( std::move( first_inclusive ) ), last( std::move( last_exclusive ) ) { }
+
+				bool operator()( value_type& value ) {
+					if( first == last ) {
+						return false;
+					}
+					value = *first;
+					++first;
+					return true;
+				}
+			};
+
+			struct stream_all {
+				template<typename T>
+				bool operator()( const T& ) const {
+					return true;
+				}
+			};
+
+			// Fuses a where clause onto the previous filter
+			template<typename Prev, typename Predicate>
+			struct stream_where {
+				Prev prev;
+				Predicate pred;
+
+				stream_where( Prev p, Predicate pr ): prev( std::move( p ) ), pred( std::move( pr ) ) { }
+
+				template<typename T>
+				bool operator()( const T& value ) const {
+					return prev( value ) && pred( value );
+				}
+			};
+		}	// namespace impl
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: A single pass range over a generator.  The generator is a
+		/// callable bool( value_type& ) that writes the next value and returns
+		/// false once the source is exhausted, such as an adapted
+		/// std::istream_iterator.  Values are pulled chunk_size at a time into one
+		/// reused buffer and filtered as they flow to the terminal, so memory use
+		/// is bounded by the chunk size rather than the length of the source.
+		/// Copies share the generator and the first terminal consumes it.
+		template<typename value_type, typename Generator, typename Filter = impl::stream_all>
+		class StreamingRange {
+		public:
+			static const size_t default_chunk_size = 4096;
+
+			StreamingRange( std::shared_ptr<Generator> generator, Filter filter, size_t chunk_size = default_chunk_size ): m_generator( std::move( generator ) ), m_filter( std::move( filter ) ), m_chunk_size( 0 == chunk_size ? 1 : chunk_size ) { }
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Adds a predicate that when false for a value filters out
+			/// the value.  Fuses with the neighbouring where clauses
+			template<typename Predicate>
+			StreamingRange<value_type, Generator, impl::stream_where<Filter, Predicate>> where( Predicate pred ) const {
+				return StreamingRange<value_type, Generator, impl::stream_where<Filter, Predicate>>( m_generator, impl::stream_where<Filter, Predicate>( m_filter, std::move( pred ) ), m_chunk_size );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Number of values pulled from the generator at a time
+			StreamingRange with_chunk_size( size_t chunk_size ) const {
+				return StreamingRange( m_generator, m_filter, chunk_size );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  On every valid value do something.  Returns the
+			/// number of values passed to func
+			template<typename Func>
+			size_t for_each( Func func ) const {
+				size_t result = 0;
+				run( [&func, &result]( value_type& value ) {
+					func( value );
+					++result;
+					return true;
+				} );
+				return result;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Copy valid values to the provided range up to
+			/// the smallest list and return the position after the last value
+			/// written.  Values already pulled into the current chunk past that
+			/// point are dropped
+			template<typename Iter>
+			Iter copy_to( Iter first_inclusive, Iter last_exclusive ) const {
+				auto out_it = first_inclusive;
+				if( out_it == last_exclusive ) {
+					return out_it;
+				}
+				run( [&out_it, &last_exclusive]( value_type& value ) {
+					*out_it++ = value;
+					return out_it != last_exclusive;
+				} );
+				return out_it;
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Number of valid values
+			size_t count( ) const {
+				return for_each( []( value_type& ) { } );
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			/// Summary: Terminal.  Copy all valid values to a std::vector
+			std::vector<value_type> to_vector( ) const {
+				auto result = std::vector<value_type>( );
+				for_each( [&result]( value_type& value ) { result.push_back( std::move( value ) ); } );
+				return result;
+			}
+
+		private:
+			std::shared_ptr<Generator> m_generator;
+			Filter m_filter;
+			size_t m_chunk_size;
+
+			// Pulls a chunk, then feeds its valid values to sink until the sink
+			// returns false or the generator runs out.  The buffer is reused so
+			// values such as strings keep their capacity between chunks
+			template<typename Sink>
+			void run( Sink sink ) const {
+				auto& generator = *m_generator;
+				auto chunk = std::vector<value_type>( m_chunk_size );
+				size_t pulled;
+				do {
+					pulled = 0;
+					while( pulled < m_chunk_size && generator( chunk[pulled] ) ) {
+						++pulled;
+					}
+					for( size_t n = 0; n < pulled; ++n ) {
+						if( m_filter( chunk[n] ) && !sink( chunk[n] ) ) {
+							return;
+						}
+					}
+				} while( pulled == m_chunk_size );
+			}
+		};	// class StreamingRange
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Creates a StreamingRange over an input iterator pair such as
+		/// std::istream_iterator
+		template<typename InputIter>
+		auto create_streaming_range( InputIter first_inclusive, InputIter last_exclusive ) -> StreamingRange<typename std::iterator_traits<InputIter>::value_type, impl::iterator_generator<typename std::iterator_traits<InputIter>::value_type, InputIter>> {
+			using value_type = typename std::iterator_traits<InputIter>::value_type;
+			using generator_type = impl::iterator_generator<value_type, InputIter>;
+			return StreamingRange<value_type, generator_type>( std::make_shared<generator_type>( std::move( first_inclusive ), std::move( last_exclusive ) ), impl::stream_all( ) );
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		/// Summary: Creates a StreamingRange over a generator, a callable
+		/// bool( value_type& ) that returns false when it has no more values
+		template<typename value_type, typename Generator>
+		StreamingRange<value_type, Generator> create_streaming_range( Generator generator ) {
+			return StreamingRange<value_type, Generator>( std::make_shared<Generator>( std::move( generator ) ), impl::stream_all( ) );
+		}
+	}	// namespace range
+}	// namespace daw
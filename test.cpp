@@ -52,8 +52,19 @@ bool are_different( const Container1& container1, const Container2& container2 )
 #include <boost/test/unit_test.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
 #include "daw/filtered_range.h"
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 
 using namespace daw::range;
 
@@ -253,9 +264,40 @@ BOOST_AUTO_TEST_CASE( int_test ) {
 	}
 
 	// stable_unique
-	// TODO: create test case
 	{
+		auto test_vals = copy_of( test_values );
+
+		auto tmp_vec = std::vector<int>( );
+		for( auto value : test_vals ) {
+			if( std::find( begin( tmp_vec ), end( tmp_vec ), value ) == end( tmp_vec ) ) {
+				tmp_vec.push_back( value );
+			}
+		}
+
+		auto tmp = create_filtered_range( test_vals ).stable_unique( ).to_vector( );
+		if( tmp.size( ) != tmp_vec.size( ) || are_different( tmp, tmp_vec ) ) {
+			BOOST_FAIL( "stable_unique did not function correctly" );
+		}
+		auto same_parity = []( const int& lhs, const int& rhs ) { return lhs % 2 == rhs % 2; };
+		if( are_different( create_filtered_range( test_vals ).stable_unique( same_parity ).to_vector( ), std::vector<int>( { 100, 1 } ) ) ) {
+			BOOST_FAIL( "stable_unique with a comparator did not function correctly" );
+		}
+		auto parity_hash = []( const int& value ) { return static_cast<size_t>( value % 2 ); };
+		if( are_different( create_filtered_range( test_vals ).stable_unique( parity_hash, same_parity ).to_vector( ), std::vector<int>( { 100, 1 } ) ) ) {
+			BOOST_FAIL( "stable_unique with a hash did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "stable_unique has mutated the underlying container" );
+		}
 
+		auto strings = std::vector<std::string>( );
+		for( int n = 0; n < 5000; ++n ) {
+			strings.push_back( std::to_string( (n * 7919) % 3001 ) );
+		}
+		auto unique_strings = create_filtered_range( strings ).stable_unique( ).to_vector( );
+		if( unique_strings.size( ) != 3001 || unique_strings[0] != strings[0] || unique_strings[1] != strings[1] ) {
+			BOOST_FAIL( "stable_unique over strings did not keep the first occurrences in order" );
+		}
 	}
 
 	// partition
@@ -325,7 +367,7 @@ BOOST_AUTO_TEST_CASE( int_test ) {
 		assert( num_old == num_new );
 
 		auto test_vals = copy_of( test_values );
-		auto tmp = create_filtered_range( test_values ).replace( old_val, new_val ).to_vector( );
+		auto tmp = create_filtered_range( test_vals ).replace( old_val, new_val ).to_vector( );
 		if( num_new != std::count( begin( tmp ), end( tmp ), new_val ) ) {
 			BOOST_FAIL( "replace did not function correctly" );
 		}
@@ -353,4 +395,1038 @@ BOOST_AUTO_TEST_CASE( int_test ) {
 			}
 		}
 	}
+
+	// lazy
+	{
+		auto test_vals = copy_of( test_values );
+
+		auto tmp_vec = std::vector<int>( );
+		std::copy_if( begin( test_vals ), end( test_vals ), std::back_inserter( tmp_vec ), []( int value ) { return 0 == value % 2 && value < 50; } );
+		std::sort( begin( tmp_vec ), end( tmp_vec ) );
+		tmp_vec.erase( std::unique( begin( tmp_vec ), end( tmp_vec ) ), end( tmp_vec ) );
+		std::reverse( begin( tmp_vec ), end( tmp_vec ) );
+
+		int pred_calls = 0;
+		auto view = create_filtered_range( test_vals ).lazy( )
+			.where( [&pred_calls]( const int& value ) { ++pred_calls; return 0 == value % 2; } )
+			.where( []( const int& value ) { return value < 50; } )
+			.sort( ).unique( ).reverse( );
+		if( 0 != pred_calls ) {
+			BOOST_FAIL( "lazy evaluated a where clause before a terminal operation" );
+		}
+		if( are_different( view.to_vector( ), tmp_vec ) || view.to_vector( ).size( ) != tmp_vec.size( ) ) {
+			BOOST_FAIL( "lazy pipeline did not match the eager result" );
+		}
+		if( are_different( view.to_filtered_range( ).to_vector( ), tmp_vec ) ) {
+			BOOST_FAIL( "lazy to_filtered_range did not match the eager result" );
+		}
+		if( !view.contains( 22 ) || view.contains( 100 ) || view.contains( 3 ) ) {
+			BOOST_FAIL( "lazy contains did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "lazy has mutated the underlying container" );
+		}
+	}
+
+	// predicate algebra
+	{
+		auto test_vals = copy_of( test_values );
+		auto in_range = is_greater( 3 ) && is_less_or_equal( 10 );
+		auto in_range2 = is_less( 10 ) && is_greater_or_equal( 3 );
+		auto in_set = is_any_of( is_equal( 1 ), is_equal( 7 ), is_equal( 55 ), is_even<int>( ) );
+		auto in_strings = is_equal( std::string( "b" ) ) || is_equal( std::string( "a" ) );
+		for( auto value : test_vals ) {
+			if( in_range( value ) != (3 < value && value <= 10) || in_range2( value ) != (3 <= value && value < 10) ) {
+				BOOST_FAIL( "range check did not match the separate comparisons" );
+			}
+			if( in_set( value ) != (1 == value || 7 == value || 55 == value || 0 == value % 2) ) {
+				BOOST_FAIL( "is_any_of did not match the separate comparisons" );
+			}
+			if( is_none_of( is_equal( 3 ), is_odd<int>( ) )( value ) != (3 != value && 0 == value % 2) ) {
+				BOOST_FAIL( "is_none_of did not function correctly" );
+			}
+			if( is_all_of( is_greater( 2 ), is_odd<int>( ), is_not_equal( 7 ) )( value ) != (2 < value && 0 != value % 2 && 7 != value) ) {
+				BOOST_FAIL( "is_all_of did not function correctly" );
+			}
+		}
+		if( (is_greater( 5 ) && is_less( 6 ))( 5 ) || (is_greater( std::numeric_limits<int>::max( ) ) && is_less( 0 ))( 0 ) ) {
+			BOOST_FAIL( "empty range check matched a value" );
+		}
+		if( !in_strings( "a" ) || !in_strings( "b" ) || in_strings( "c" ) ) {
+			BOOST_FAIL( "equality set over strings did not function correctly" );
+		}
+		auto extremes = is_equal( std::numeric_limits<int64_t>::min( ) ) || is_equal( std::numeric_limits<int64_t>::max( ) );
+		if( !extremes( std::numeric_limits<int64_t>::min( ) ) || !extremes( std::numeric_limits<int64_t>::max( ) ) || extremes( int64_t( 0 ) ) ) {
+			BOOST_FAIL( "equality set spanning a whole 64-bit type did not function correctly" );
+		}
+		if( create_filtered_range( test_vals ).where( in_range ).to_vector( ).size( ) != static_cast<size_t>( std::count_if( begin( test_vals ), end( test_vals ), in_range ) ) ) {
+			BOOST_FAIL( "where did not accept a predicate object" );
+		}
+		auto reals = std::vector<double>( { 0.5, std::numeric_limits<double>::quiet_NaN( ), 2.0 } );
+		auto fused = create_filtered_range( reals ).where( is_greater_or_equal( 0.0 ) && is_less_or_equal( 1.0 ) ).size( );
+		auto chained = create_filtered_range( reals ).where( is_greater_or_equal( 0.0 ) ).where( is_less_or_equal( 1.0 ) ).size( );
+		if( fused != 1 || chained != 1 || (is_greater( 0.0 ) && is_less( 1.0 ))( std::numeric_limits<double>::quiet_NaN( ) ) ) {
+			BOOST_FAIL( "range check over floating point did not reject NaN" );
+		}
+	}
+
+	// copy on write
+	{
+		auto test_vals = copy_of( test_values );
+		auto base = create_filtered_range( test_vals );
+		auto branch = base.where( is_even<int>( ) );
+		auto sorted = base.sort( );
+		auto sorted_branch = branch.sort( );
+		if( are_different( base.to_vector( ), test_values ) || base.to_vector( ).size( ) != test_values.size( ) ) {
+			BOOST_FAIL( "modifying a copy of a range changed the original" );
+		}
+		if( are_different( sorted.to_vector( ), std::vector<int>( { 1, 2, 3, 3, 3, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11, 11, 22, 55, 100 } ) ) ) {
+			BOOST_FAIL( "sort on a shared range did not function correctly" );
+		}
+		if( are_different( sorted_branch.to_vector( ), std::vector<int>( { 2, 4, 6, 8, 10, 10, 22, 100 } ) ) || branch.to_vector( ).size( ) != 8 ) {
+			BOOST_FAIL( "filtering a shared range did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "copy on write has mutated the underlying container" );
+		}
+	}
+
+	// selection
+	{
+		auto test_vals = std::vector<int>( 200 );
+		for( size_t n = 0; n < test_vals.size( ); ++n ) {
+			test_vals[n] = static_cast<int>( n );
+		}
+		auto base = create_selected_range( test_vals );
+		auto evens = base.where( is_even<int>( ) );
+		auto small_evens = evens.where( is_less( 130 ) ).where( is_greater( 64 ) );
+		auto tmp_vec = create_filtered_range( test_vals ).where( is_even<int>( ) ).where( is_less( 130 ) ).where( is_greater( 64 ) ).to_vector( );
+		if( small_evens.size( ) != tmp_vec.size( ) || are_different( small_evens.to_vector( ), tmp_vec ) ) {
+			BOOST_FAIL( "SelectedRange.where did not function correctly" );
+		}
+		if( small_evens.where( base.where( is_odd<int>( ) ) ).size( ) != 0 || !base.where( is_odd<int>( ) ).where( is_even<int>( ) ).empty( ) ) {
+			BOOST_FAIL( "SelectedRange.where did not combine selections correctly" );
+		}
+		if( small_evens.clear_where( ).size( ) != test_vals.size( ) || are_different( small_evens.clear_where( ).to_vector( ), test_vals ) ) {
+			BOOST_FAIL( "SelectedRange.clear_where did not restore all values" );
+		}
+		if( !small_evens.contains( 66 ) || small_evens.contains( 64 ) || small_evens.contains( 67 ) ) {
+			BOOST_FAIL( "SelectedRange.contains did not function correctly" );
+		}
+		if( are_different( small_evens.to_filtered_range( ).sort( std::greater<int>( ) ).to_vector( ), std::vector<int>( tmp_vec.rbegin( ), tmp_vec.rend( ) ) ) ) {
+			BOOST_FAIL( "SelectedRange.to_filtered_range did not function correctly" );
+		}
+		auto other_vals = copy_of( test_vals );
+		try {
+			base.where( create_selected_range( other_vals ) );
+			BOOST_FAIL( "SelectedRange.where accepted a selection over another source" );
+		} catch( const std::invalid_argument& ) { }
+	}
+
+	// simd where
+	{
+		using namespace daw::range::impl::simd;
+		auto int_vals = std::vector<int32_t>( 1000 );
+		auto float_vals = std::vector<float>( int_vals.size( ) );
+		uint32_t seed = 12345;
+		for( size_t n = 0; n < int_vals.size( ); ++n ) {
+			seed = seed * 1664525u + 1013904223u;
+			int_vals[n] = static_cast<int32_t>( seed ) % 200 - 100;
+			float_vals[n] = static_cast<float>( int_vals[n] ) / 4.0f;
+		}
+		int_vals[3] = std::numeric_limits<int32_t>::min( );
+		int_vals[4] = std::numeric_limits<int32_t>::max( );
+		float_vals[5] = std::numeric_limits<float>::quiet_NaN( );
+
+		auto const word_count = ( int_vals.size( ) + 63 ) / 64;
+		auto const ops = { op::less, op::less_equal, op::greater, op::greater_equal, op::equal, op::not_equal, op::even, op::odd, op::in_span };
+		for( auto code : ops ) {
+			for( auto use_level = level::scalar; use_level <= best_level( ); use_level = static_cast<level>( static_cast<int>( use_level ) + 1 ) ) {
+				auto expected = std::vector<uint64_t>( word_count, 0 );
+				auto actual = std::vector<uint64_t>( word_count, 0 );
+				evaluate_scalar<int32_t>( code, int_vals.data( ), 0, int_vals.size( ) - 1, 7, 20, expected.data( ) );
+				evaluate<int32_t>( use_level, code, int_vals.data( ), int_vals.size( ) - 1, 7, 20, actual.data( ) );
+				if( expected != actual ) {
+					BOOST_FAIL( "vectorized int32_t kernel did not match the scalar loop" );
+				}
+				if( code == op::even || code == op::odd || code == op::in_span ) {
+					continue;
+				}
+				std::fill( expected.begin( ), expected.end( ), 0 );
+				std::fill( actual.begin( ), actual.end( ), 0 );
+				evaluate_scalar<float>( code, float_vals.data( ), 0, float_vals.size( ), 1.25f, 0.0f, expected.data( ) );
+				evaluate<float>( use_level, code, float_vals.data( ), float_vals.size( ), 1.25f, 0.0f, actual.data( ) );
+				if( expected != actual ) {
+					BOOST_FAIL( "vectorized float kernel did not match the scalar loop" );
+				}
+			}
+		}
+
+		auto selected = create_selected_range( int_vals ).where( is_greater( -50 ) && is_less_or_equal( 60 ) ).where( is_odd<int32_t>( ) ).where( is_not_equal( 13 ) );
+		auto tmp_vec = create_filtered_range( int_vals ).where( is_greater( -50 ) && is_less_or_equal( 60 ) ).where( is_odd<int32_t>( ) ).where( is_not_equal( 13 ) ).to_vector( );
+		if( selected.size( ) != tmp_vec.size( ) || are_different( selected.to_vector( ), tmp_vec ) ) {
+			BOOST_FAIL( "SelectedRange.where over contiguous values did not match FilteredRange.where" );
+		}
+		if( !create_selected_range( int_vals ).where( is_greater( 10 ) && is_less( 5 ) ).empty( ) ) {
+			BOOST_FAIL( "SelectedRange.where with an empty range check selected values" );
+		}
+	}
+
+	// create_indexed_range
+	{
+		auto test_vals = copy_of( test_values );
+		auto test_deque = std::deque<int>( begin( test_values ), end( test_values ) );
+		auto indexed = create_indexed_range( test_vals );
+		auto indexed_deque = create_indexed_range<uint64_t>( test_deque );
+		auto refs = create_filtered_range( test_vals );
+		static_assert(sizeof( decltype(indexed)::element_type ) == sizeof( uint32_t ), "create_indexed_range should store 32-bit indices by default");
+
+		if( are_different( indexed.sort( ).to_vector( ), refs.sort( ).to_vector( ) ) || are_different( indexed_deque.sort( ).to_vector( ), refs.sort( ).to_vector( ) ) ) {
+			BOOST_FAIL( "create_indexed_range sort did not function correctly" );
+		}
+		if( are_different( indexed.where( is_odd<int>( ) ).stable_unique( ).to_vector( ), refs.where( is_odd<int>( ) ).stable_unique( ).to_vector( ) ) ) {
+			BOOST_FAIL( "create_indexed_range stable_unique did not function correctly" );
+		}
+		if( are_different( indexed.sorted_unique( ).to_vector( ), refs.sorted_unique( ).to_vector( ) ) || are_different( indexed.duplicates( ).to_vector( ), refs.duplicates( ).to_vector( ) ) ) {
+			BOOST_FAIL( "create_indexed_range sorted_unique or duplicates did not function correctly" );
+		}
+		if( are_different( indexed.stable_partition( is_even<int>( ) ).reverse( ).to_vector( ), refs.stable_partition( is_even<int>( ) ).reverse( ).to_vector( ) ) ) {
+			BOOST_FAIL( "create_indexed_range stable_partition or reverse did not function correctly" );
+		}
+		if( !indexed.contains( 55 ) || indexed.where( is_less( 50 ) ).contains( 55 ) ) {
+			BOOST_FAIL( "create_indexed_range contains did not function correctly" );
+		}
+		if( indexed.append( begin( test_vals ), begin( test_vals ) + 3 ).to_vector( ).size( ) != test_vals.size( ) + 3 ) {
+			BOOST_FAIL( "create_indexed_range append from the same source did not function correctly" );
+		}
+		if( indexed_deque.append( test_deque.begin( ) + 2, test_deque.end( ) ).to_vector( ).size( ) != 2 * test_deque.size( ) - 2 ) {
+			BOOST_FAIL( "create_indexed_range append from the same deque did not function correctly" );
+		}
+		{
+			auto other_vals = copy_of( test_values );
+			auto other_deque = std::deque<int>( begin( test_values ), end( test_values ) );
+			try {
+				indexed.append( begin( other_vals ), end( other_vals ) );
+				BOOST_FAIL( "create_indexed_range append from another container did not throw" );
+			} catch( const std::out_of_range& ) { }
+			try {
+				indexed_deque.append( other_deque.begin( ), other_deque.end( ) );
+				BOOST_FAIL( "create_indexed_range append from another deque did not throw" );
+			} catch( const std::out_of_range& ) { }
+		}
+		if( are_different( indexed.lazy( ).where( is_even<int>( ) ).sort( ).to_vector( ), refs.where( is_even<int>( ) ).sort( ).to_vector( ) ) ) {
+			BOOST_FAIL( "create_indexed_range lazy did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "create_indexed_range has mutated the underlying container" );
+		}
+		indexed.where( is_equal( 3 ) ).for_each( []( int& value ) { value = -3; } );
+		if( 3 != std::count( begin( test_vals ), end( test_vals ), -3 ) ) {
+			BOOST_FAIL( "create_indexed_range for_each did not allow mutation of the values" );
+		}
+	}
+
+	// duplicates, stable_duplicates, frequencies, count_duplicates
+	{
+		auto test_vals = copy_of( test_values );
+		auto test_vals2 = copy_of( test_values2 );
+		auto tmp = create_filtered_range( test_vals ).append( begin( test_vals2 ), end( test_vals2 ) );
+		auto equal = []( const int& lhs, const int& rhs ) { return lhs == rhs; };
+
+		auto const sorted_dups = std::vector<int>( { 3, 7, 10, 11, 100, 201 } );
+		auto const stable_dups = std::vector<int>( { 100, 3, 7, 10, 11, 201 } );
+		if( are_different( tmp.duplicates( ).to_vector( ), sorted_dups ) || tmp.duplicates( ).to_vector( ).size( ) != sorted_dups.size( ) || are_different( tmp.duplicates( equal ).to_vector( ), sorted_dups ) ) {
+			BOOST_FAIL( "duplicates did not function correctly" );
+		}
+		if( are_different( tmp.stable_duplicates( ).to_vector( ), stable_dups ) || tmp.stable_duplicates( ).to_vector( ).size( ) != stable_dups.size( ) || are_different( tmp.stable_duplicates( equal ).to_vector( ), stable_dups ) ) {
+			BOOST_FAIL( "stable_duplicates did not function correctly" );
+		}
+		auto freqs = tmp.where( is_greater( 9 ) ).frequencies( );
+		if( freqs.size( ) != 9 || freqs[0] != std::make_pair( 100, size_t( 2 ) ) || freqs[2] != std::make_pair( 11, size_t( 2 ) ) || freqs[5] != std::make_pair( 200, size_t( 1 ) ) ) {
+			BOOST_FAIL( "frequencies did not function correctly" );
+		}
+		if( tmp.count_duplicates( ) != 7 || tmp.stable_unique( ).count_duplicates( ) != 0 ) {
+			BOOST_FAIL( "count_duplicates did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "duplicates has mutated the underlying container" );
+		}
+	}
+
+	// parallel sort, stable_sort, partition, stable_partition, sorted_unique, reverse
+	{
+		auto big_vals = std::vector<int>( 100000 );
+		unsigned int seed = 12345;
+		for( auto& value : big_vals ) {
+			seed = seed * 1103515245u + 12345u;
+			value = static_cast<int>((seed >> 8) % 5000);
+		}
+		auto const big_copy = big_vals;
+		auto tmp = create_filtered_range( big_vals ).where( is_not_equal( 42 ) );
+		auto by_tens = []( const int& lhs, const int& rhs ) { return lhs / 10 < rhs / 10; };
+		auto const pol = daw::range::execution::par.with_threads( 4 );
+
+		if( are_different( tmp.sort( pol ).to_vector( ), tmp.sort( ).to_vector( ) ) || are_different( tmp.sort( pol, by_tens ).to_vector( ), tmp.stable_sort( by_tens ).to_vector( ) ) ) {
+			BOOST_FAIL( "parallel sort did not function correctly" );
+		}
+		if( are_different( tmp.stable_sort( pol, by_tens ).to_vector( ), tmp.stable_sort( by_tens ).to_vector( ) ) || are_different( tmp.stable_sort( daw::range::execution::par.with_threads( 3 ), by_tens ).to_vector( ), tmp.stable_sort( by_tens ).to_vector( ) ) ) {
+			BOOST_FAIL( "parallel stable_sort did not function correctly" );
+		}
+		if( are_different( tmp.stable_partition( pol, is_even<int>( ) ).to_vector( ), tmp.stable_partition( is_even<int>( ) ).to_vector( ) ) || are_different( tmp.partition( pol, is_less( 100 ) ).to_vector( ), tmp.stable_partition( is_less( 100 ) ).to_vector( ) ) ) {
+			BOOST_FAIL( "parallel partition did not function correctly" );
+		}
+		auto const serial_unique = tmp.sorted_unique( ).to_vector( );
+		if( serial_unique.size( ) != 4999 || are_different( tmp.sorted_unique( pol ).to_vector( ), serial_unique ) ) {
+			BOOST_FAIL( "parallel sorted_unique did not function correctly" );
+		}
+		if( are_different( tmp.reverse( pol ).to_vector( ), tmp.reverse( ).to_vector( ) ) || are_different( tmp.where( is_odd<int>( ) ).reverse( daw::range::execution::seq ).to_vector( ), tmp.where( is_odd<int>( ) ).reverse( ).to_vector( ) ) ) {
+			BOOST_FAIL( "parallel reverse did not function correctly" );
+		}
+
+		size_t submitted = 0;
+		auto inline_pool = pol.on( [&submitted]( std::function<void( )> task ) {
+			++submitted;
+			task( );
+		} );
+		if( are_different( tmp.stable_sort( inline_pool, by_tens ).to_vector( ), tmp.stable_sort( by_tens ).to_vector( ) ) || 0 == submitted ) {
+			BOOST_FAIL( "parallel stable_sort did not use the executor" );
+		}
+		if( are_different( big_vals, big_copy ) ) {
+			BOOST_FAIL( "parallel algorithms have mutated the underlying container" );
+		}
+	}
+
+	// parallel where, for_each
+	{
+		auto words = std::vector<std::string>( );
+		for( size_t n = 0; n < 20000; ++n ) {
+			words.push_back( std::to_string( n * 7919 ) + (0 == n % 3 ? " deserves" : " needs") );
+		}
+		auto const pol = daw::range::execution::par.with_threads( 4 ).with_chunk_size( 333 );
+		auto has_deserve = []( const std::string& value ) { return std::string::npos != value.find( "deserve" ); };
+		auto text = create_filtered_range( words ).where( []( const std::string& value ) { return '1' != value[0]; } );
+
+		auto const serial = text.where( has_deserve ).to_vector( );
+		if( are_different( text.where( pol, has_deserve ).to_vector( ), serial ) || text.where( pol, has_deserve ).to_vector( ).size( ) != serial.size( ) || serial.empty( ) ) {
+			BOOST_FAIL( "parallel where did not function correctly" );
+		}
+		if( are_different( text.where( daw::range::execution::seq, has_deserve ).to_vector( ), serial ) || are_different( text.where( pol.with_chunk_size( 1 << 20 ), has_deserve ).to_vector( ), serial ) ) {
+			BOOST_FAIL( "parallel where with one chunk did not function correctly" );
+		}
+
+		auto test_vals = std::vector<int>( 10000 );
+		for( size_t n = 0; n < test_vals.size( ); ++n ) {
+			test_vals[n] = static_cast<int>(n);
+		}
+		std::atomic<long long> sum( 0 );
+		create_filtered_range( test_vals ).where( is_odd<int>( ) ).for_each( pol.with_chunk_size( 7 ), [&sum]( int& value ) {
+			sum += value;
+			value = -value;
+		} );
+		if( 25000000 != sum || -9999 != test_vals[9999] || 9998 != test_vals[9998] || 5000 != std::count_if( begin( test_vals ), end( test_vals ), is_less( 0 ) ) ) {
+			BOOST_FAIL( "parallel for_each did not function correctly" );
+		}
+	}
+
+	// set_union, set_intersection, set_difference, set_symmetric_difference
+	{
+		auto test_vals = std::vector<int>( );
+		for( int n = 0; n < 3000; ++n ) {
+			test_vals.push_back( (n * 7919) % 1000 );
+		}
+		auto lhs_vals = std::vector<int>( );
+		auto rhs_vals = std::vector<int>( );
+		std::copy_if( begin( test_vals ), end( test_vals ), std::back_inserter( lhs_vals ), is_even<int>( ) );
+		std::copy_if( begin( test_vals ), end( test_vals ), std::back_inserter( rhs_vals ), []( int value ) { return 0 == value % 3; } );
+		std::sort( begin( lhs_vals ), end( lhs_vals ) );
+		std::sort( begin( rhs_vals ), end( rhs_vals ) );
+		auto expected = []( const std::vector<int>& a, const std::vector<int>& b, int op ) {
+			auto result = std::vector<int>( );
+			switch( op ) {
+			case 0: std::set_union( begin( a ), end( a ), begin( b ), end( b ), std::back_inserter( result ) ); break;
+			case 1: std::set_intersection( begin( a ), end( a ), begin( b ), end( b ), std::back_inserter( result ) ); break;
+			case 2: std::set_difference( begin( a ), end( a ), begin( b ), end( b ), std::back_inserter( result ) ); break;
+			default: std::set_symmetric_difference( begin( a ), end( a ), begin( b ), end( b ), std::back_inserter( result ) ); break;
+			}
+			return result;
+		};
+		auto all = create_filtered_range( test_vals );
+		auto lhs = all.where( is_even<int>( ) );
+		auto rhs = all.where( []( int value ) { return 0 == value % 3; } );
+		auto check = [&expected]( const std::vector<int>& actual, const std::vector<int>& a, const std::vector<int>& b, int op ) {
+			auto const wanted = expected( a, b, op );
+			return actual.size( ) == wanted.size( ) && !are_different( actual, wanted );
+		};
+		if( !check( lhs.set_union( rhs ).to_vector( ), lhs_vals, rhs_vals, 0 ) || !check( lhs.sort( ).set_union( rhs.sort( ) ).to_vector( ), lhs_vals, rhs_vals, 0 ) ) {
+			BOOST_FAIL( "set_union did not function correctly" );
+		}
+		if( !check( lhs.set_intersection( rhs ).to_vector( ), lhs_vals, rhs_vals, 1 ) || !check( rhs.set_intersection( lhs ).to_vector( ), rhs_vals, lhs_vals, 1 ) ) {
+			BOOST_FAIL( "set_intersection did not function correctly" );
+		}
+		if( !check( lhs.set_difference( rhs ).to_vector( ), lhs_vals, rhs_vals, 2 ) || !check( lhs.set_symmetric_difference( rhs ).to_vector( ), lhs_vals, rhs_vals, 3 ) ) {
+			BOOST_FAIL( "set_difference or set_symmetric_difference did not function correctly" );
+		}
+
+		// Skewed sizes gallop through the larger side
+		auto few = all.where( is_less( 4 ) );
+		auto few_vals = std::vector<int>( );
+		std::copy_if( begin( test_vals ), end( test_vals ), std::back_inserter( few_vals ), is_less( 4 ) );
+		std::sort( begin( few_vals ), end( few_vals ) );
+		auto all_vals = copy_of( test_vals );
+		std::sort( begin( all_vals ), end( all_vals ) );
+		if( !check( few.set_intersection( all.sort( ) ).to_vector( ), few_vals, all_vals, 1 ) || !check( all.set_intersection( few ).to_vector( ), all_vals, few_vals, 1 ) || !check( lhs.set_intersection( few ).to_vector( ), lhs_vals, few_vals, 1 ) ) {
+			BOOST_FAIL( "set_intersection of skewed sizes did not function correctly" );
+		}
+
+		// Ranges already sorted by the same comparator are merged without sorting,
+		// after a linear check that they are still in order
+		static size_t comparisons;
+		struct counting_less {
+			bool operator()( int lhs, int rhs ) const {
+				++comparisons;
+				return lhs < rhs;
+			}
+		};
+		auto sorted_lhs = lhs.sort( counting_less( ) );
+		auto sorted_rhs = rhs.sort( counting_less( ) );
+		comparisons = 0;
+		auto merged = sorted_lhs.set_union( sorted_rhs, counting_less( ) ).set_difference( sorted_rhs, counting_less( ) );
+		if( comparisons > 5 * (lhs_vals.size( ) + rhs_vals.size( )) || !check( merged.to_vector( ), lhs_vals, rhs_vals, 2 ) ) {
+			BOOST_FAIL( "set operations re-sorted ranges that were already sorted" );
+		}
+		comparisons = 0;
+		auto const sorted_size = sorted_lhs.where( is_greater( 10 ) ).sort( counting_less( ) ).size( );
+		if( comparisons + 1 > std::max( sorted_size, size_t( 1 ) ) ) {
+			BOOST_FAIL( "sort re-sorted a range that was already sorted" );
+		}
+
+		auto other_vals = copy_of( test_vals );
+		auto const original_vals = copy_of( test_vals );
+		auto indexed = create_indexed_range( test_vals );
+		try {
+			indexed.set_union( create_indexed_range( other_vals ) );
+			BOOST_FAIL( "set operations over different sources did not throw" );
+		} catch( const std::invalid_argument& ) { }
+		if( are_different( test_vals, original_vals ) ) {
+			BOOST_FAIL( "set operations have mutated the underlying container" );
+		}
+	}
+
+	// with_lookup, contains_all, contains_any
+	{
+		auto test_vals = copy_of( test_values );
+		auto tmp = create_filtered_range( test_vals ).where( is_greater( 5 ) ).with_lookup( );
+		for( auto value : test_values ) {
+			if( tmp.contains( value ) != (value > 5) ) {
+				BOOST_FAIL( "with_lookup contains did not function correctly" );
+			}
+		}
+		auto narrowed = tmp.where( is_less( 100 ) );
+		if( narrowed.contains( 100 ) || !narrowed.contains( 55 ) || !tmp.contains( 100 ) || tmp.clear_where( ).contains( 4 ) != true ) {
+			BOOST_FAIL( "with_lookup was not rebuilt after the membership changed" );
+		}
+		auto extra = std::vector<int>( { -7 } );
+		if( !tmp.append( begin( extra ), end( extra ) ).where( is_not_equal( 6 ) ).clear_where( ).contains( -7 ) ) {
+			BOOST_FAIL( "with_lookup was not rebuilt after append" );
+		}
+		if( !tmp.contains_all( { 7, 10, 100 } ) || tmp.contains_all( { 7, 3 } ) || !tmp.contains_any( std::vector<int>( { 1, 2, 55 } ) ) || tmp.contains_any( { 1, 2, 3 } ) ) {
+			BOOST_FAIL( "contains_all or contains_any did not function correctly" );
+		}
+		auto indexed = create_indexed_range( test_vals ).where( is_odd<int>( ) );
+		if( !indexed.contains_all( { 1, 3, 55 } ) || indexed.contains_any( { 2, 4, 100 } ) || !indexed.with_lookup( ).contains( 7 ) ) {
+			BOOST_FAIL( "contains_all or contains_any over indices did not function correctly" );
+		}
+		struct unordered {
+			int value;
+			bool operator==( const unordered& rhs ) const {
+				return value == rhs.value;
+			}
+		};
+		auto plain = std::vector<unordered>( { { 1 }, { 2 }, { 3 } } );
+		auto plain_range = create_filtered_range( plain ).with_lookup( );
+		if( !plain_range.contains( unordered{ 2 } ) || plain_range.contains_any( { unordered{ 5 } } ) ) {
+			BOOST_FAIL( "with_lookup over values without hash or ordering did not function correctly" );
+		}
+		{
+			auto small_vals = std::vector<int>( { 1, 2, 3 } );
+			auto r = create_filtered_range( small_vals ).with_lookup( );
+			r.contains( 1 );
+			auto r2 = r.replace( 1, 5 );
+			if( !r2.contains( 5 ) || r2.contains( 1 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt after replace" );
+			}
+			auto r3 = r2.replace_if( is_equal( 2 ), 6 );
+			if( !r3.contains( 6 ) || r3.contains( 2 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt after replace_if" );
+			}
+			auto r4 = r3.for_each( []( int& value ) { value += 10; } );
+			if( !r4.contains( 13 ) || r4.contains( 3 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt after for_each" );
+			}
+			if( !r.contains( 13 ) || r.contains( 1 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt on the range written through" );
+			}
+		}
+		{
+			auto small_vals = std::vector<int>( { 1, 2, 3 } );
+			auto r = create_filtered_range( small_vals ).with_lookup( );
+			r.contains( 1 );
+			r.for_each( []( int& value ) { value = 9; } );
+			if( !r.contains( 9 ) || r.contains( 1 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt after for_each on the same range" );
+			}
+			r.contains( 9 );
+			r.replace( 9, 4, std::equal_to<int>( ) );
+			if( !r.contains( 4 ) || r.contains( 9 ) ) {
+				BOOST_FAIL( "with_lookup was not rebuilt after replace on the same range" );
+			}
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "with_lookup has mutated the underlying container" );
+		}
+	}
+
+	// top_k, partial_sort, nth_element, median
+	{
+		auto test_vals = copy_of( test_values );
+		auto tmp = create_filtered_range( test_vals ).where( is_not_equal( 3 ) );
+		auto sorted_vals = tmp.sort( ).to_vector( );
+		auto const greater = std::greater<int>( );
+
+		auto top = tmp.top_k( 4 ).to_vector( );
+		if( top.size( ) != 4 || !std::equal( begin( top ), end( top ), begin( sorted_vals ) ) ) {
+			BOOST_FAIL( "top_k did not function correctly" );
+		}
+		auto top_greater = tmp.top_k( 3, greater ).to_vector( );
+		if( top_greater.size( ) != 3 || !std::equal( begin( top_greater ), end( top_greater ), sorted_vals.rbegin( ) ) ) {
+			BOOST_FAIL( "top_k with a comparator did not function correctly" );
+		}
+		if( tmp.top_k( 0 ).to_vector( ).size( ) != 0 || are_different( tmp.top_k( 1000 ).to_vector( ), sorted_vals ) || tmp.top_k( 1000 ).to_vector( ).size( ) != sorted_vals.size( ) || are_different( tmp.sort( ).top_k( 2 ).to_vector( ), tmp.top_k( 2 ).to_vector( ) ) ) {
+			BOOST_FAIL( "top_k at the bounds did not function correctly" );
+		}
+
+		auto partial = tmp.partial_sort( 5 ).to_vector( );
+		if( partial.size( ) != sorted_vals.size( ) || !std::equal( begin( partial ), begin( partial ) + 5, begin( sorted_vals ) ) ) {
+			BOOST_FAIL( "partial_sort did not function correctly" );
+		}
+		auto nth = tmp.nth_element( 6 ).to_vector( );
+		if( nth.size( ) != sorted_vals.size( ) || nth[6] != sorted_vals[6] || !std::all_of( begin( nth ), begin( nth ) + 6, is_less_or_equal( nth[6] ) ) || !std::all_of( begin( nth ) + 7, end( nth ), is_greater_or_equal( nth[6] ) ) ) {
+			BOOST_FAIL( "nth_element did not function correctly" );
+		}
+		if( tmp.median( ) != sorted_vals[(sorted_vals.size( ) - 1) / 2] || tmp.sort( ).median( ) != tmp.median( ) || tmp.median( greater ) != sorted_vals[sorted_vals.size( ) / 2] ) {
+			BOOST_FAIL( "median did not function correctly" );
+		}
+		try {
+			tmp.where( is_greater( 1000 ) ).median( );
+			BOOST_FAIL( "median of an empty range did not throw" );
+		} catch( const std::out_of_range& ) { }
+		{
+			// replace writes through the shared references, so the sorted mark of s goes stale
+			auto small_vals = std::vector<int>( { 3, 1, 2 } );
+			auto s = create_filtered_range( small_vals ).sort( );
+			s.replace( 1, 10 );
+			if( s.sort( ).to_vector( ) != std::vector<int>( { 2, 3, 10 } ) || s.median( ) != 3 || s.top_k( 1 ).to_vector( ) != std::vector<int>( { 2 } ) ) {
+				BOOST_FAIL( "sort did not function correctly after replace" );
+			}
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "top_k has mutated the underlying container" );
+		}
+	}
+
+	// first, find_if, any, all, none, count, size, empty
+	{
+		auto test_vals = copy_of( test_values );
+		auto tested = std::make_shared<size_t>( 0 );
+		auto tmp = create_filtered_range( test_vals ).where( [tested]( int value ) {
+			++*tested;
+			return value > 5;
+		} );
+		auto const expected_count = static_cast<size_t>(std::count_if( begin( test_values ), end( test_values ), is_greater( 5 ) ));
+
+		auto first_big = *std::find_if( begin( test_values ), end( test_values ), is_greater( 5 ) );
+		*tested = 0;
+		if( tmp.first( ) != first_big || *tested > static_cast<size_t>(std::distance( begin( test_values ), std::find_if( begin( test_values ), end( test_values ), is_greater( 5 ) ) )) + 1 ) {
+			BOOST_FAIL( "first did not function correctly" );
+		}
+		*tested = 0;
+		if( !tmp.any( is_even<int>( ) ) || *tested == test_values.size( ) ) {
+			BOOST_FAIL( "any did not stop at the first match" );
+		}
+		if( tmp.all( is_even<int>( ) ) || !tmp.all( is_greater( 5 ) ) || !tmp.none( is_less( 5 ) ) || tmp.none( is_odd<int>( ) ) ) {
+			BOOST_FAIL( "all or none did not function correctly" );
+		}
+		auto found = tmp.find_if( is_greater( 50 ) );
+		if( nullptr == found || *found <= 50 || nullptr != tmp.find_if( is_greater( 1000 ) ) ) {
+			BOOST_FAIL( "find_if did not function correctly" );
+		}
+		auto const found_value = *found;
+		*found = -1;
+		if( std::count( begin( test_vals ), end( test_vals ), -1 ) != 1 ) {
+			BOOST_FAIL( "find_if did not point into the underlying container" );
+		}
+		*found = found_value;
+		if( tmp.count( ) != expected_count || tmp.size( ) != expected_count || tmp.count( is_odd<int>( ) ) != tmp.where( is_odd<int>( ) ).to_vector( ).size( ) ) {
+			BOOST_FAIL( "count or size did not function correctly" );
+		}
+		if( tmp.empty( ) || !tmp.where( is_greater( 1000 ) ).empty( ) ) {
+			BOOST_FAIL( "empty did not apply the predicates" );
+		}
+		try {
+			tmp.where( is_greater( 1000 ) ).first( );
+			BOOST_FAIL( "first of an empty range did not throw" );
+		} catch( const std::out_of_range& ) { }
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "find_if has mutated the underlying container" );
+		}
+	}
+
+	// create_streaming_range
+	{
+		auto input = std::stringstream( );
+		for( int n = 0; n < 1000; ++n ) {
+			input << (n * 37) % 101 << ' ';
+		}
+		auto text = input.str( );
+		auto in_stream = std::istringstream( text );
+		auto stream = create_streaming_range( std::istream_iterator<int>( in_stream ), std::istream_iterator<int>( ) ).with_chunk_size( 64 ).where( is_even<int>( ) ).where( is_less( 50 ) );
+		auto expected = std::vector<int>( );
+		for( int n = 0; n < 1000; ++n ) {
+			auto const value = (n * 37) % 101;
+			if( 0 == value % 2 && value < 50 ) {
+				expected.push_back( value );
+			}
+		}
+		auto streamed = stream.to_vector( );
+		if( streamed.size( ) != expected.size( ) || are_different( streamed, expected ) || 0 != stream.count( ) ) {
+			BOOST_FAIL( "create_streaming_range over an istream did not function correctly" );
+		}
+
+		int next = 0;
+		size_t pulled = 0;
+		auto counter = create_streaming_range<int>( [&next, &pulled]( int& value ) {
+			if( next >= 100000 ) {
+				return false;
+			}
+			++pulled;
+			value = next++;
+			return true;
+		} ).with_chunk_size( 100 );
+		auto out = std::vector<int>( 5 );
+		auto out_last = counter.where( []( int value ) { return 0 == value % 7; } ).copy_to( begin( out ), end( out ) );
+		if( out_last != end( out ) || out[4] != 28 || pulled != 100 ) {
+			BOOST_FAIL( "create_streaming_range copy_to did not stop pulling early" );
+		}
+		if( counter.where( is_greater( 99989 ) ).for_each( []( int& ) { } ) != 10 ) {
+			BOOST_FAIL( "create_streaming_range for_each did not continue from the generator" );
+		}
+	}
+
+	// create_mapped_range
+	{
+		auto const path = std::string( "filtered_range_mapped_test.bin" );
+		auto records = std::vector<int64_t>( );
+		for( int64_t n = 0; n < 5000; ++n ) {
+			records.push_back( (n * 7919) % 1000 );
+		}
+		{
+			auto out = std::ofstream( path, std::ios::binary );
+			out.write( reinterpret_cast<const char*>(records.data( )), static_cast<std::streamsize>(records.size( ) * sizeof( int64_t )) );
+		}
+		{
+			auto file = std::make_shared<daw::range::mapped_file<int64_t>>( path, daw::range::access_hint::random );
+			file->prefetch( 0, 1024 );
+			auto mapped = create_mapped_range( file );
+			auto refs = create_filtered_range( records );
+			if( mapped.size( ) != records.size( ) || are_different( mapped.where( is_greater( int64_t( 900 ) ) ).sort( ).to_vector( ), refs.where( is_greater( int64_t( 900 ) ) ).sort( ).to_vector( ) ) ) {
+				BOOST_FAIL( "create_mapped_range did not function correctly" );
+			}
+			if( mapped.where( is_less( int64_t( 10 ) ) ).set_intersection( create_mapped_range( file ).where( is_even<int64_t>( ) ) ).count( ) != refs.where( is_less( int64_t( 10 ) ) ).count( is_even<int64_t>( ) ) ) {
+				BOOST_FAIL( "create_mapped_range set operations did not function correctly" );
+			}
+			auto from_path = create_mapped_range<int64_t>( path );
+			from_path.where( is_equal( int64_t( 0 ) ) ).for_each( []( int64_t& value ) { value = -1; } );
+			if( 0 == from_path.count( is_equal( int64_t( -1 ) ) ) || mapped.contains( -1 ) ) {
+				BOOST_FAIL( "create_mapped_range did not keep changes private to the mapping" );
+			}
+		}
+		auto reread = std::vector<int64_t>( records.size( ) );
+		{
+			auto in = std::ifstream( path, std::ios::binary );
+			in.read( reinterpret_cast<char*>(reread.data( )), static_cast<std::streamsize>(reread.size( ) * sizeof( int64_t )) );
+		}
+		std::remove( path.c_str( ) );
+		if( are_different( reread, records ) ) {
+			BOOST_FAIL( "create_mapped_range has modified the file" );
+		}
+		try {
+			create_mapped_range<int64_t>( path );
+			BOOST_FAIL( "create_mapped_range of a missing file did not throw" );
+		} catch( const std::system_error& ) { }
+	}
+
+	// FilteredRangeGroup
+	{
+		auto day1 = copy_of( test_values );
+		auto day2 = copy_of( test_values2 );
+		auto day3 = std::vector<int>( { 55, 7, 3000, -2 } );
+		auto group = create_filtered_range_group( std::vector<FilteredRange<int>>( { create_filtered_range( day1 ), create_filtered_range( day2 ), create_filtered_range( day3 ) } ) ).with_policy( daw::range::execution::par.with_threads( 3 ) );
+		auto all = create_filtered_range( day1 ).append( begin( day2 ), end( day2 ) ).append( begin( day3 ), end( day3 ) );
+
+		if( group.shard_count( ) != 3 || group.size( ) != all.size( ) || group.where( is_odd<int>( ) ).size( ) != all.where( is_odd<int>( ) ).size( ) ) {
+			BOOST_FAIL( "FilteredRangeGroup size or where did not function correctly" );
+		}
+		if( are_different( group.where( is_greater( 5 ) ).merge( ).to_vector( ), all.where( is_greater( 5 ) ).stable_sort( ).to_vector( ) ) || group.merge( ).to_vector( ).size( ) != all.size( ) ) {
+			BOOST_FAIL( "FilteredRangeGroup merge did not function correctly" );
+		}
+		auto global_unique = all.sorted_unique( ).to_vector( );
+		auto merged_unique = group.merge_unique( ).to_vector( );
+		if( merged_unique.size( ) != global_unique.size( ) || are_different( merged_unique, global_unique ) ) {
+			BOOST_FAIL( "FilteredRangeGroup merge_unique did not function correctly" );
+		}
+		auto by_shard = group.where( is_less( 100 ) ).sort( std::greater<int>( ) ).unique( );
+		if( are_different( by_shard.shard( 2 ).to_vector( ), std::vector<int>( { 55, 7, -2 } ) ) || by_shard.shard( 2 ).to_vector( ).size( ) != 3 ) {
+			BOOST_FAIL( "FilteredRangeGroup sort or unique did not function correctly" );
+		}
+		std::atomic<long long> sum( 0 );
+		group.for_each( [&sum]( int value ) { sum += value; } );
+		long long expected_sum = 0;
+		all.for_each( [&expected_sum]( int value ) { expected_sum += value; } );
+		if( sum != expected_sum || !group.contains( 3000 ) || group.where( is_less( 0 ) ).contains( 3000 ) ) {
+			BOOST_FAIL( "FilteredRangeGroup for_each or contains did not function correctly" );
+		}
+		if( !(group.sorted_unique( ) == group.sorted_unique( )) || group.sorted_unique( ) == group || !(group.add( create_filtered_range( day3 ) ) == group.add( create_filtered_range( day3 ) )) ) {
+			BOOST_FAIL( "FilteredRangeGroup operator== did not function correctly" );
+		}
+		auto many = std::vector<FilteredRange<int>>( 200, create_filtered_range( day3 ) );
+		auto thread_ids = std::set<std::thread::id>( );
+		std::mutex thread_ids_mutex;
+		create_filtered_range_group( many ).with_policy( daw::range::execution::par.with_threads( 2 ) ).where( is_odd<int>( ) ).for_each( [&]( int ) {
+			std::lock_guard<std::mutex> lock( thread_ids_mutex );
+			thread_ids.insert( std::this_thread::get_id( ) );
+		} );
+		if( thread_ids.size( ) > 2 ) {
+			BOOST_FAIL( "FilteredRangeGroup used more threads than its policy allows" );
+		}
+		if( has_mutated( day1 ) ) {
+			BOOST_FAIL( "FilteredRangeGroup has mutated the underlying container" );
+		}
+	}
+
+	// group_by
+	{
+		struct sale {
+			std::string tenant;
+			int amount;
+		};
+		auto sales = std::vector<sale>( { { "a", 10 }, { "b", 5 }, { "a", -3 }, { "c", 7 }, { "b", 20 }, { "a", 4 } } );
+		auto by_tenant = create_filtered_range( sales ).where( []( const sale& s ) { return s.amount != 7; } ).group_by( []( const sale& s ) { return s.tenant; }, 4 );
+		auto amount = []( const sale& s ) { return s.amount; };
+
+		auto counts = by_tenant.count( );
+		if( counts.size( ) != 2 || counts[0] != std::make_pair( std::string( "a" ), size_t( 3 ) ) || counts[1] != std::make_pair( std::string( "b" ), size_t( 2 ) ) ) {
+			BOOST_FAIL( "group_by count did not function correctly" );
+		}
+		auto sums = by_tenant.sum( amount );
+		auto mins = by_tenant.min( amount );
+		auto maxes = by_tenant.max( amount );
+		if( sums[0].second != 11 || sums[1].second != 25 || mins[0].second != -3 || mins[1].second != 5 || maxes[0].second != 10 || maxes[1].second != 20 ) {
+			BOOST_FAIL( "group_by sum, min or max did not function correctly" );
+		}
+		auto joined = by_tenant.fold( std::string( ), []( std::string acc, const sale& s ) { return acc + std::to_string( s.amount ) + ";"; } );
+		if( joined[0].second != "10;-3;4;" || joined[1].second != "5;20;" ) {
+			BOOST_FAIL( "group_by fold did not function correctly" );
+		}
+
+		auto test_vals = copy_of( test_values );
+		auto parity = create_filtered_range( test_vals ).group_by( []( int value ) { return value % 2; } );
+		auto parity_sums = parity.sum( );
+		auto const odd_sum = std::accumulate( begin( test_values ), end( test_values ), 0, []( int acc, int value ) { return acc + (value % 2 == 1 ? value : 0); } );
+		auto const odd_pos = parity_sums[0].first == 1 ? 0 : 1;
+		if( parity_sums.size( ) != 2 || parity_sums[odd_pos].second != odd_sum || parity.max( )[odd_pos].second != *std::max_element( begin( test_values ), end( test_values ), []( int lhs, int rhs ) { return (lhs % 2 == 1 ? lhs : -1000) < (rhs % 2 == 1 ? rhs : -1000); } ) ) {
+			BOOST_FAIL( "group_by over values did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "group_by has mutated the underlying container" );
+		}
+	}
+
+	// sum, min, max, minmax, mean, reduce
+	{
+		auto test_vals = copy_of( test_values );
+		auto const expected_sum = std::accumulate( begin( test_values ), end( test_values ), 0 );
+		auto const expected_minmax = std::minmax_element( begin( test_values ), end( test_values ) );
+		auto range = create_filtered_range( test_vals );
+		if( range.sum( ) != expected_sum || range.min( ) != *expected_minmax.first || range.max( ) != *expected_minmax.second ) {
+			BOOST_FAIL( "sum, min or max did not function correctly" );
+		}
+		auto const mean = range.mean( );
+		if( mean < static_cast<double>(expected_sum) / test_values.size( ) - 1e-9 || mean > static_cast<double>(expected_sum) / test_values.size( ) + 1e-9 ) {
+			BOOST_FAIL( "mean did not function correctly" );
+		}
+
+		auto odd = range.where( []( int value ) { return value % 2 != 0; } );
+		auto odd_values = odd.to_vector( );
+		auto const odd_bounds = odd.minmax( );
+		if( odd.sum( ) != std::accumulate( begin( odd_values ), end( odd_values ), 0 ) || odd_bounds.first != *std::min_element( begin( odd_values ), end( odd_values ) ) || odd_bounds.second != *std::max_element( begin( odd_values ), end( odd_values ) ) ) {
+			BOOST_FAIL( "sum or minmax with a where clause did not function correctly" );
+		}
+		if( odd.reduce( std::string( ), []( std::string acc, int value ) { return acc + std::to_string( value ); } ) != std::accumulate( begin( odd_values ), end( odd_values ), std::string( ), []( std::string acc, int value ) { return acc + std::to_string( value ); } ) ) {
+			BOOST_FAIL( "reduce did not function correctly" );
+		}
+
+		auto none = range.where( []( int ) { return false; } );
+		if( none.sum( ) != 0 ) {
+			BOOST_FAIL( "sum of an empty range did not function correctly" );
+		}
+		try {
+			none.minmax( );
+			BOOST_FAIL( "minmax of an empty range did not throw" );
+		} catch( const std::out_of_range& ) { }
+		try {
+			none.mean( );
+			BOOST_FAIL( "mean of an empty range did not throw" );
+		} catch( const std::out_of_range& ) { }
+
+		auto doubles = std::vector<double>( { 0.5, -2.25, 8.0, 1.5, 3.25 } );
+		auto double_range = create_filtered_range( doubles );
+		if( double_range.sum( ) != 11.0 || double_range.min( ) != -2.25 || double_range.max( ) != 8.0 || double_range.mean( ) != 2.2 ) {
+			BOOST_FAIL( "sum, min, max or mean of doubles did not function correctly" );
+		}
+		auto const inf = std::numeric_limits<double>::infinity( );
+		auto positive = std::vector<double>( { inf, inf } );
+		auto negative = std::vector<double>( { -inf, -inf, -inf, -inf, -inf } );
+		if( create_filtered_range( positive ).minmax( ) != std::make_pair( inf, inf ) || create_filtered_range( positive ).min( ) != inf || create_filtered_range( negative ).max( ) != -inf || create_filtered_range( negative ).where( []( double ) { return true; } ).minmax( ) != std::make_pair( -inf, -inf ) ) {
+			BOOST_FAIL( "min, max or minmax of infinities did not function correctly" );
+		}
+		auto words = std::vector<std::string>( { "pear", "apple", "fig" } );
+		auto word_range = create_filtered_range( words );
+		if( word_range.sum( ) != "pearapplefig" || word_range.min( ) != "apple" || word_range.max( ) != "pear" ) {
+			BOOST_FAIL( "sum, min or max of strings did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "reductions have mutated the underlying container" );
+		}
+	}
+
+	// radix sort of integral and floating point values
+	{
+		auto ints = std::vector<int>( );
+		auto wide = std::vector<uint64_t>( );
+		auto reals = std::vector<double>( );
+		for( int n = 0; n < 2000; ++n ) {
+			ints.push_back( (n * 7919) % 401 - 200 );
+			wide.push_back( static_cast<uint64_t>(n % 97) * 0x0123456789ULL + static_cast<uint64_t>(n % 3) );
+			reals.push_back( 0 == n % 50 ? -0.0 : static_cast<double>((n * 31) % 257 - 128) / 8.0 );
+		}
+		auto const original_ints = ints;
+		auto expected_ints = ints;
+		std::stable_sort( begin( expected_ints ), end( expected_ints ) );
+
+		auto sorted = create_filtered_range( ints ).sort( );
+		auto stably_sorted = create_filtered_range( ints ).stable_sort( );
+		if( sorted.to_vector( ) != expected_ints || stably_sorted.to_vector( ) != expected_ints ) {
+			BOOST_FAIL( "radix sort of ints did not function correctly" );
+		}
+		// Equal values keep the order of their positions in the source
+		const int* last_value = nullptr;
+		auto stable = true;
+		stably_sorted.for_each( [&last_value, &stable]( const int& value ) {
+			if( nullptr != last_value && *last_value == value && !(last_value < &value) ) {
+				stable = false;
+			}
+			last_value = &value;
+		} );
+		if( !stable ) {
+			BOOST_FAIL( "radix sort of ints is not stable" );
+		}
+		auto descending = create_filtered_range( ints ).where( []( int value ) { return value != 0; } ).sort( std::greater<int>( ) ).to_vector( );
+		auto expected_descending = ints;
+		expected_descending.erase( std::remove( begin( expected_descending ), end( expected_descending ), 0 ), end( expected_descending ) );
+		std::sort( begin( expected_descending ), end( expected_descending ), std::greater<int>( ) );
+		if( descending != expected_descending ) {
+			BOOST_FAIL( "radix sort with std::greater did not function correctly" );
+		}
+		auto expected_unique = expected_ints;
+		expected_unique.erase( std::unique( begin( expected_unique ), end( expected_unique ) ), end( expected_unique ) );
+		if( create_indexed_range( ints ).sorted_unique( ).to_vector( ) != expected_unique ) {
+			BOOST_FAIL( "radix sort of an indexed range did not function correctly" );
+		}
+
+		auto expected_wide = wide;
+		std::sort( begin( expected_wide ), end( expected_wide ) );
+		if( create_filtered_range( wide ).sort( ).to_vector( ) != expected_wide ) {
+			BOOST_FAIL( "radix sort of uint64_t did not function correctly" );
+		}
+
+		auto expected_reals = reals;
+		std::stable_sort( begin( expected_reals ), end( expected_reals ) );
+		auto sorted_reals = create_filtered_range( reals ).stable_sort( ).to_vector( );
+		if( sorted_reals != expected_reals || !std::equal( begin( sorted_reals ), end( sorted_reals ), begin( expected_reals ), []( double lhs, double rhs ) { return std::signbit( lhs ) == std::signbit( rhs ); } ) ) {
+			BOOST_FAIL( "radix sort of doubles did not function correctly" );
+		}
+		if( ints != original_ints ) {
+			BOOST_FAIL( "radix sort has mutated the underlying container" );
+		}
+	}
+
+	// with_adaptive_where
+	{
+		auto values = std::vector<int>( 10000 );
+		std::iota( begin( values ), end( values ), 0 );
+		auto const original_values = values;
+		size_t slow_calls = 0;
+		// Added first but rejects almost nothing, so it should be evaluated last
+		auto rarely_rejects = [&slow_calls]( int value ) {
+			++slow_calls;
+			return value != 5003;
+		};
+		auto multiple_of_100 = []( int value ) { return 0 == value % 100; };
+		auto plain = create_filtered_range( values ).where( rarely_rejects ).where( multiple_of_100 );
+		auto adaptive = plain.with_adaptive_where( 64, 4096 );
+
+		auto expected = plain.to_vector( );
+		slow_calls = 0;
+		auto adaptive_values = adaptive.to_vector( );
+		if( adaptive_values != expected || adaptive_values.size( ) != 100 ) {
+			BOOST_FAIL( "with_adaptive_where changed the values in the range" );
+		}
+		// Every value in the three samples, then only the multiples of 100
+		if( slow_calls > 3 * 64 + 100 ) {
+			BOOST_FAIL( "with_adaptive_where did not evaluate the selective predicate first" );
+		}
+		if( adaptive.count( ) != 100 || adaptive.sum( ) != std::accumulate( begin( expected ), end( expected ), 0 ) || *adaptive.find_if( []( int value ) { return value > 5000; } ) != 5100 ) {
+			BOOST_FAIL( "with_adaptive_where did not function correctly with count, sum or find_if" );
+		}
+		if( adaptive.where( []( int value ) { return value < 300; } ).sort( std::greater<int>( ) ).to_vector( ) != std::vector<int>( { 200, 100, 0 } ) ) {
+			BOOST_FAIL( "with_adaptive_where did not function correctly with sort" );
+		}
+		if( values != original_values ) {
+			BOOST_FAIL( "with_adaptive_where has mutated the underlying container" );
+		}
+	}
+
+	// instrument::set_observer, instrument::counters
+	{
+		auto test_vals = copy_of( test_values );
+		auto reports = std::vector<instrument::operation_stats>( );
+		instrument::set_observer( [&reports]( const instrument::operation_stats& stats ) { reports.push_back( stats ); } );
+		create_filtered_range( test_vals ).where( []( int value ) { return value > 5; } ).where( []( int value ) { return value % 2 == 0; } ).sort( );
+		instrument::set_observer( instrument::observer_type( ) );
+#ifdef DAW_RANGE_INSTRUMENT
+		// filter runs inside sort, so it is reported first
+		if( reports.size( ) != 2 || std::string( reports[0].name ) != "filter" || std::string( reports[1].name ) != "sort" ) {
+			BOOST_FAIL( "instrumentation did not report the operations" );
+		}
+		auto const greater_than_5 = static_cast<size_t>(std::count_if( begin( test_values ), end( test_values ), []( int value ) { return value > 5; } ));
+		auto const even = static_cast<size_t>(std::count_if( begin( test_values ), end( test_values ), []( int value ) { return value > 5 && value % 2 == 0; } ));
+		auto const & filter = reports[0];
+		if( filter.elements_in != test_values.size( ) || filter.elements_out != even || filter.predicate_calls != std::vector<size_t>( { test_values.size( ), greater_than_5 } ) || 0 == filter.bytes_allocated ) {
+			BOOST_FAIL( "instrumentation did not count the filter correctly" );
+		}
+		if( reports[1].elements_in != test_values.size( ) || reports[1].elements_out != even || !reports[1].predicate_calls.empty( ) ) {
+			BOOST_FAIL( "instrumentation did not count the sort correctly" );
+		}
+#else
+		if( !reports.empty( ) ) {
+			BOOST_FAIL( "instrumentation reported operations while disabled" );
+		}
+#endif
+		instrument::counters totals;
+		instrument::set_observer( totals.observer( ) );
+		auto range = create_filtered_range( test_vals ).where( []( int value ) { return value != 3; } );
+		range.count( );
+		range.count( );
+		instrument::set_observer( instrument::observer_type( ) );
+		auto snapshot = totals.snapshot( );
+#ifdef DAW_RANGE_INSTRUMENT
+		if( snapshot.size( ) != 1 || snapshot["scan"].calls != 2 || snapshot["scan"].predicate_calls != 2 * test_values.size( ) || snapshot["scan"].elements_out != 2 * (test_values.size( ) - static_cast<size_t>(std::count( begin( test_values ), end( test_values ), 3 ))) ) {
+			BOOST_FAIL( "instrument::counters did not total the operations" );
+		}
+#else
+		if( !snapshot.empty( ) ) {
+			BOOST_FAIL( "instrument::counters were updated while disabled" );
+		}
+#endif
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "instrumentation has mutated the underlying container" );
+		}
+	}
+	// with_resource, monotonic_arena, resource_allocator
+	{
+		auto test_vals = copy_of( test_values );
+		auto is_odd = []( int value ) { return value % 2 != 0; };
+		auto expected = create_filtered_range( test_vals ).where( is_odd ).stable_unique( ).sort( ).duplicates( ).to_vector( );
+		auto expected_unique = create_filtered_range( test_vals ).where( is_odd ).stable_unique( ).to_vector( );
+		auto expected_odd = create_filtered_range( test_vals ).where( is_odd ).to_vector( );
+		monotonic_arena arena( 1024 );
+		{
+			auto range = create_filtered_range( test_vals ).with_resource( arena );
+			if( 0 == arena.bytes_allocated( ) ) {
+				BOOST_FAIL( "with_resource did not allocate from the arena" );
+			}
+			if( range.where( is_odd ).stable_unique( ).sort( ).duplicates( ).to_vector( ) != expected || range.where( is_odd ).stable_unique( ).to_vector( ) != expected_unique ) {
+				BOOST_FAIL( "with_resource did not function correctly" );
+			}
+			auto const bytes = arena.bytes_allocated( );
+			auto values = range.where( is_odd ).to_vector( resource_allocator<int>( &arena ) );
+			if( arena.bytes_allocated( ) <= bytes || values.get_allocator( ).resource( ) != &arena || values.size( ) != expected_odd.size( ) || !std::equal( values.begin( ), values.end( ), expected_odd.begin( ) ) ) {
+				BOOST_FAIL( "to_vector did not function correctly with a resource_allocator" );
+			}
+		}
+		arena.release( );
+		if( 0 != arena.bytes_allocated( ) ) {
+			BOOST_FAIL( "monotonic_arena::release did not release the blocks" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "with_resource has mutated the underlying container" );
+		}
+	}
+	// where and for_each by reference, into, move_to_vector
+	{
+		auto test_vals = copy_of( test_values );
+		struct counted {
+			int value;
+			size_t* copies;
+			counted( int v, size_t* c ): value( v ), copies( c ) { }
+			counted( const counted& other ): value( other.value ), copies( other.copies ) {
+				++*copies;
+			}
+			counted& operator=(const counted& other) {
+				value = other.value;
+				copies = other.copies;
+				++*copies;
+				return *this;
+			}
+		};
+		size_t copies = 0;
+		auto values = std::vector<counted>( );
+		for( auto value : test_vals ) {
+			values.emplace_back( value, &copies );
+		}
+		copies = 0;
+		int total = 0;
+		create_filtered_range( values ).where( []( const counted& c ) { return c.value > 5; } ).where( []( const counted& c ) { return c.value % 2 == 0; } ).for_each( [&total]( const counted& c ) { total += c.value; } );
+		if( 0 != copies || total != std::accumulate( begin( test_vals ), end( test_vals ), 0, []( int sum, int value ) { return value > 5 && value % 2 == 0 ? sum + value : sum; } ) ) {
+			BOOST_FAIL( "where or for_each copied the values" );
+		}
+
+		auto expected = create_filtered_range( test_vals ).where( is_odd<int>( ) ).to_vector( );
+		auto into_values = std::deque<int>( );
+		auto out_it = create_filtered_range( test_vals ).where( is_odd<int>( ) ).into( std::back_inserter( into_values ) );
+		*out_it = 0;
+		expected.push_back( 0 );
+		if( into_values.size( ) != expected.size( ) || !std::equal( into_values.begin( ), into_values.end( ), expected.begin( ) ) ) {
+			BOOST_FAIL( "into did not function correctly" );
+		}
+
+		auto strings = std::vector<std::string>( { "a long string that is not stored inline", "short", "another long string that is not stored inline" } );
+		auto moved = create_filtered_range( strings ).where( []( const std::string& value ) { return value.size( ) > 5; } ).move_to_vector( );
+		if( moved != std::vector<std::string>( { "a long string that is not stored inline", "another long string that is not stored inline" } ) || strings[1] != "short" ) {
+			BOOST_FAIL( "move_to_vector did not function correctly" );
+		}
+		if( has_mutated( test_vals ) ) {
+			BOOST_FAIL( "into has mutated the underlying container" );
+		}
+	}
 }
\ No newline at end of file